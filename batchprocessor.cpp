@@ -0,0 +1,518 @@
+#include "batchprocessor.h"
+#include "imageprocessor.h"
+#include "cpuprocessor.h"
+#include "imagedecoder.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QTextStream>
+
+/**
+ * Tells whether the application has been launched in command line mode,
+ * in which case no window must be created.
+ *
+ * @brief BatchProcessor::isRequested
+ * @param argc
+ * @param argv
+ * @return true if a batch option is in the arguments, --help alone is left to the window
+ */
+bool BatchProcessor::isRequested(int argc, char *argv[]) {
+    for(int i = 1; i < argc; i++) {
+
+        // the options can be followed by their value or by "=" and their value
+        QString argument = QString(argv[i]).section('=', 0, 0);
+        if(argument == "--filter" || argument == "--in" || argument == "--out"
+                || argument == "--backend" || argument == "--validate") {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Parses the description of a stage such as "bilateral:k=9,sigma=2,range=0.3".
+ * The filter is one of gaussian, bilateral, sharpening or edge,
+ * the parameters are k (kernel size), sigma (deviation), range, scale, algo,
+ * and low and high for the thresholds of Canny.
+ *
+ * @brief BatchProcessor::parseFilter
+ * @param description
+ * @param stage the parsed stage
+ * @param error the reason why the description is invalid
+ * @return true if the description is valid
+ */
+bool BatchProcessor::parseFilter(const QString& description, FilterStage& stage, QString& error) {
+
+    // the names of the algorithms' variants, in the order of FilterStage::algorithm
+    static const QStringList gbAlgorithms = QStringList() << "separable" << "2d" << "box" << "boxgauss";
+    static const QStringList bfAlgorithms = QStringList() << "exact" << "grid";
+    static const QStringList edAlgorithms = QStringList() << "log" << "sobel" << "prewitt" << "canny";
+
+    // choosing the filter
+    QString name = description.section(':', 0, 0).trimmed().toLower();
+    if(name == "gaussian" || name == "gb") {
+        stage = FilterStage(GAUSSIAN_BLUR);
+    } else if(name == "bilateral" || name == "bf") {
+        stage = FilterStage(BILATERAL_FILTER);
+    } else if(name == "sharpening" || name == "sharpen" || name == "sh") {
+        stage = FilterStage(SHARPENING);
+    } else if(name == "edge" || name == "ed") {
+        stage = FilterStage(EDGE_DETECTION);
+    } else {
+        error = QString("unknown filter \"%1\"").arg(name);
+        return false;
+    }
+
+    // reading its parameters
+    QStringList parameters = description.section(':', 1).split(',', QString::SkipEmptyParts);
+    for(const QString& parameter : parameters) {
+        QString key = parameter.section('=', 0, 0).trimmed().toLower();
+        QString value = parameter.section('=', 1).trimmed();
+        bool ok = true;
+
+        if(key == "k" || key == "size") {
+            stage.kernelSize = value.toInt(&ok);
+        } else if(key == "sigma" || key == "deviation") {
+            stage.deviation = value.toFloat(&ok);
+        } else if(key == "range") {
+            stage.range = value.toFloat(&ok);
+        } else if(key == "scale") {
+            stage.scaleFactor = value.toFloat(&ok);
+        } else if(key == "low") {
+            stage.lowThreshold = value.toFloat(&ok);
+        } else if(key == "high") {
+            stage.highThreshold = value.toFloat(&ok);
+        } else if(key == "algo" || key == "algorithm") {
+            const QStringList& algorithms = (stage.type == EDGE_DETECTION) ? edAlgorithms
+                                          : (stage.type == BILATERAL_FILTER) ? bfAlgorithms : gbAlgorithms;
+            stage.algorithm = algorithms.indexOf(value.toLower());
+            ok = stage.algorithm >= 0;
+        } else {
+            error = QString("unknown parameter \"%1\" in \"%2\"").arg(key, description);
+            return false;
+        }
+
+        if(!ok) {
+            error = QString("invalid value \"%1\" for \"%2\" in \"%3\"").arg(value, key, description);
+            return false;
+        }
+    }
+
+    // the kernel has a center and is limited by the shaders
+    int maxKernelSize = ImageProcessor::MAX_KERNEL_SIZE;
+    if(stage.type == GAUSSIAN_BLUR && stage.algorithm == 0) {
+        maxKernelSize = ImageProcessor::MAX_SEPARABLE_KERNEL_SIZE;
+    } else if(stage.type == GAUSSIAN_BLUR && stage.algorithm >= ImageProcessor::BOX_ALGORITHM) {
+        maxKernelSize = ImageProcessor::MAX_BOX_KERNEL_SIZE;
+    }
+    if(stage.kernelSize < 3 || stage.kernelSize > maxKernelSize || stage.kernelSize % 2 == 0) {
+        error = QString("the kernel size must be odd, between 3 and %1 in \"%2\"").arg(maxKernelSize).arg(description);
+        return false;
+    }
+    if(stage.deviation <= 0.0f || stage.range <= 0.0f) {
+        error = QString("sigma and range must be positive in \"%1\"").arg(description);
+        return false;
+    }
+    if(stage.lowThreshold < 0.0f || stage.lowThreshold > stage.highThreshold) {
+        error = QString("the low threshold must be between 0 and the high one in \"%1\"").arg(description);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Lists the images to process.
+ *
+ * @brief BatchProcessor::listImages
+ * @param path a file or a directory
+ * @return the path of every image
+ */
+QStringList BatchProcessor::listImages(const QString& path) const {
+    QFileInfo info(path);
+    if(!info.isDir()) {
+        return QStringList() << path;
+    }
+
+    // every file of the directory with an extension that can be read
+    return ImageDecoder::listImages(path);
+}
+
+/**
+ * Checks the result of an image against the cpu backend if needed, and saves it with the name of the input.
+ *
+ * @brief BatchProcessor::finishImage
+ * @param inputFile
+ * @param image the input image
+ * @param result the processed image, null when the processing failed
+ */
+void BatchProcessor::finishImage(const QString& inputFile, const QImage& image, const QImage& result) {
+    QTextStream err(stderr);
+    if(result.isNull()) {
+        err << "cannot process " << inputFile << endl;
+        return;
+    }
+
+    // checking the cpu backend against the gl one, both in 8 bits as the cpu backend computes them
+    if(validate) {
+        int maxDifference = 0;
+        int mismatchCount = compareImages(result.convertToFormat(QImage::Format_RGBA8888),
+                                          cpuProcessor.process(image, pipeline).convertToFormat(QImage::Format_RGBA8888),
+                                          tolerance, maxDifference);
+        if(mismatchCount > 0) {
+            invalidCount++;
+            err << inputFile << ": " << mismatchCount << " pixels differ by more than " << tolerance
+                << " (max " << maxDifference << ")" << endl;
+        }
+    }
+
+    // saving with the name of the input
+    QString outputFile = outputDirectory.filePath(QFileInfo(inputFile).fileName());
+    if(!result.save(outputFile)) {
+        err << "cannot write " << outputFile << endl;
+        return;
+    }
+    processedCount++;
+}
+
+/**
+ * Processes the images packed into atlases, and finishes each of them.
+ * When validating, each cell is also compared to its image rendered alone.
+ *
+ * @brief BatchProcessor::finishAtlas
+ * @param processor
+ * @param inputFiles the files of the images, emptied
+ * @param images the images, all of the same size, emptied
+ */
+void BatchProcessor::finishAtlas(ImageProcessor& processor, QStringList& inputFiles, QList<QImage>& images) {
+    QList<QImage> results = processor.processAtlas(images, pipeline);
+    if(validate) {
+        QTextStream err(stderr);
+        for(int i = 0; i < images.size() && i < results.size(); i++) {
+            if(results[i].isNull()) {
+                continue;
+            }
+            processor.loadImage(images[i]);
+            int maxDifference = 0;
+            int mismatchCount = compareImages(results[i].convertToFormat(QImage::Format_RGBA8888),
+                                              processor.renderImage(pipeline).convertToFormat(QImage::Format_RGBA8888),
+                                              tolerance, maxDifference);
+            if(mismatchCount > 0) {
+                invalidCount++;
+                err << inputFiles[i] << ": " << mismatchCount << " pixels of its atlas cell differ by more than "
+                    << tolerance << " from its render alone (max " << maxDifference << ")" << endl;
+            }
+        }
+    }
+    for(int i = 0; i < images.size(); i++) {
+        finishImage(inputFiles[i], images[i], i < results.size() ? results[i] : QImage());
+    }
+    inputFiles.clear();
+    images.clear();
+}
+
+/**
+ * Compares two images of the same size channel by channel, both in QImage::Format_RGBA8888.
+ *
+ * @brief BatchProcessor::compareImages
+ * @param first
+ * @param second
+ * @param tolerance the biggest accepted difference of a channel
+ * @param maxDifference the biggest difference found
+ * @return the number of pixels with a channel differing more than the tolerance
+ */
+int BatchProcessor::compareImages(const QImage& first, const QImage& second, int tolerance, int& maxDifference) {
+    maxDifference = 0;
+    int mismatchCount = 0;
+    for(int y = 0; y < first.height(); y++) {
+        const uchar* firstLine = first.constScanLine(y);
+        const uchar* secondLine = second.constScanLine(y);
+        for(int x = 0; x < first.width(); x++) {
+            int pixelDifference = 0;
+            for(int c = 0; c < 4; c++) {
+                pixelDifference = qMax(pixelDifference, qAbs(firstLine[4*x + c] - secondLine[4*x + c]));
+            }
+            maxDifference = qMax(maxDifference, pixelDifference);
+            if(pixelDifference > tolerance) {
+                mismatchCount++;
+            }
+        }
+    }
+    return mismatchCount;
+}
+
+/**
+ * Runs the command line mode.
+ * With the opengl backend, creates an offscreen context, which can be a software one such as Mesa llvmpipe.
+ * With the cpu backend, no context is needed at all.
+ * Processes every input image through the pipeline and reports the throughput.
+ *
+ * @brief BatchProcessor::run
+ * @param arguments
+ * @return the exit code of the application
+ */
+int BatchProcessor::run(const QStringList& arguments) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // declaring the options
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Applies the filter pipeline to images without any window.\n"
+                                     "Without a display, run with -platform offscreen (or minimalegl),\n"
+                                     "LIBGL_ALWAYS_SOFTWARE=1 forces the Mesa software renderer.");
+    parser.addHelpOption();
+    QCommandLineOption filterOption("filter", "Appends a stage to the pipeline, such as "
+                                    "gaussian:k=15,sigma=3 (algo=box,k=101 or algo=boxgauss,sigma=50 for the wide ones), bilateral:k=9,sigma=2,range=0.3 (algo=grid for the fast one), "
+                                    "sharpening:scale=2, edge:algo=sobel or edge:algo=canny,low=0.05,high=0.15 (thresholds of the Sobel magnitude divided by 4*sqrt(2)).", "stage");
+    QCommandLineOption inOption("in", "The image or the directory of images to process.", "path");
+    QCommandLineOption outOption("out", "The directory receiving the processed images.", "path");
+    QCommandLineOption backendOption("backend", "gl (default) or cpu.", "backend", "gl");
+    QCommandLineOption simdOption("simd", "The instruction set of the cpu backend: scalar, sse2 or avx, "
+                                  "the best supported one by default.", "set");
+    QCommandLineOption threadsOption("threads", "The number of threads of the cpu backend.", "count");
+    QCommandLineOption tileOption("tile", "Processes the images in tiles of this size, "
+                                  "images bigger than the biggest texture are always tiled.", "size");
+    QCommandLineOption validateOption("validate", "Also runs the cpu backend and compares it to the gl one, "
+                                      "with --atlas also compares each cell to its image rendered alone.");
+    QCommandLineOption toleranceOption("tolerance", "The biggest accepted difference of a channel "
+                                       "when validating, 2 by default.", "value", "2");
+    QCommandLineOption atlasOption("atlas", "Packs the small images of the same size into atlases, "
+                                   "each processed with a single render and read back with a single transfer. "
+                                   "The pipelines with a bilateral grid are not packed.");
+    QCommandLineOption precisionOption("precision", "gamma8 (default) processes the 8 bits values as they are, "
+                                       "linear16f converts them to linear light in 16 bits floats. "
+                                       "16 bits images are only processed in 16 bits with linear16f, "
+                                       "gamma8 reduces them to 8 bits at the first pass.", "precision", "gamma8");
+    QCommandLineOption noComputeOption("no-compute", "Runs every pass with the fragment shaders, "
+                                       "even when the context supports the compute shaders of OpenGL 4.3.");
+    QCommandLineOption timingsOption("timings", "Measures every pass with the gpu and writes "
+                                     "the timings of the last images into this json file.", "file");
+    parser.addOption(filterOption);
+    parser.addOption(inOption);
+    parser.addOption(outOption);
+    parser.addOption(backendOption);
+    parser.addOption(simdOption);
+    parser.addOption(threadsOption);
+    parser.addOption(tileOption);
+    parser.addOption(validateOption);
+    parser.addOption(toleranceOption);
+    parser.addOption(atlasOption);
+    parser.addOption(precisionOption);
+    parser.addOption(noComputeOption);
+    parser.addOption(timingsOption);
+    parser.process(arguments);
+
+    if(!parser.isSet(inOption) || !parser.isSet(outOption)) {
+        err << "both --in and --out are required" << endl;
+        return 1;
+    }
+
+    // building the pipeline in the order of the options
+    pipeline.clear();
+    for(const QString& description : parser.values(filterOption)) {
+        FilterStage stage;
+        QString error;
+        if(!parseFilter(description, stage, error)) {
+            err << error << endl;
+            return 1;
+        }
+        pipeline.append(stage);
+    }
+
+    // preparing the cpu backend, which can check the gl one
+    if(parser.value(backendOption) != "gl" && parser.value(backendOption) != "cpu") {
+        err << "unknown backend " << parser.value(backendOption) << endl;
+        return 1;
+    }
+    bool useGL = parser.value(backendOption) == "gl";
+    validate = useGL && parser.isSet(validateOption);
+    tolerance = parser.value(toleranceOption).toInt();
+    ImageProcessor::Precision precision = ImageProcessor::GAMMA_8BIT;
+    if(parser.value(precisionOption) == ImageProcessor::precisionName(ImageProcessor::LINEAR_FLOAT16)) {
+        precision = ImageProcessor::LINEAR_FLOAT16;
+    } else if(parser.value(precisionOption) != ImageProcessor::precisionName(ImageProcessor::GAMMA_8BIT)) {
+        err << "unknown precision " << parser.value(precisionOption) << endl;
+        return 1;
+    }
+    if(validate && precision == ImageProcessor::LINEAR_FLOAT16) {
+        err << "the cpu backend only processes gamma8, --validate cannot check linear16f" << endl;
+        return 1;
+    }
+    if(parser.isSet(simdOption)) {
+        static const QStringList instructionSets = QStringList() << "scalar" << "sse2" << "avx";
+        int instructionSet = instructionSets.indexOf(parser.value(simdOption).toLower());
+        if(instructionSet < 0) {
+            err << "unknown instruction set " << parser.value(simdOption) << endl;
+            return 1;
+        }
+        cpuProcessor.setInstructionSet((CpuProcessor::InstructionSet)instructionSet);
+    }
+    if(parser.isSet(threadsOption)) {
+        cpuProcessor.setThreadCount(parser.value(threadsOption).toInt());
+    }
+
+    // preparing the input and the output
+    QStringList inputFiles = listImages(parser.value(inOption));
+    outputDirectory = QDir(parser.value(outOption));
+    if(!outputDirectory.mkpath(".")) {
+        err << "cannot create " << outputDirectory.path() << endl;
+        return 1;
+    }
+
+    // creating the offscreen context, the shaders need opengl 3.3
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QOffscreenSurface surface;
+    QOpenGLContext context;
+    if(useGL) {
+        surface.setFormat(format);
+        surface.create();
+        context.setFormat(format);
+        if(!context.create() || !context.makeCurrent(&surface)) {
+            err << "cannot create an OpenGL 3.3 context, --backend cpu runs without it" << endl;
+            return 1;
+        }
+        out << "OpenGL renderer: " << (const char*)context.functions()->glGetString(GL_RENDERER) << endl;
+    }
+    if(!useGL || validate) {
+        out << "CPU backend: " << CpuProcessor::instructionSetName(cpuProcessor.getInstructionSet())
+            << ", " << cpuProcessor.getThreadCount() << " threads" << endl;
+    }
+
+    // creating the shaders and the quad
+    ImageProcessor processor;
+    int maxTextureSize = 0;
+    if(useGL) {
+        processor.initialize();
+        out << QString("Shader programs: %1 loaded from the cache, %2 compiled")
+               .arg(processor.getProgramCache().getLoadedCount())
+               .arg(processor.getProgramCache().getCompiledCount()) << endl;
+        processor.setTimingEnabled(parser.isSet(timingsOption));
+        processor.setPrecision(precision);
+        processor.setComputeEnabled(!parser.isSet(noComputeOption));
+        out << "Compute shaders: " << (!processor.isComputeAvailable() ? "unavailable"
+                                       : (processor.isComputeEnabled() ? "enabled" : "disabled")) << endl;
+        maxTextureSize = processor.getMaxTextureSize();
+    }
+    int tileSize = parser.value(tileOption).toInt();
+
+    // processing every image
+    processedCount = 0;
+    invalidCount = 0;
+    QStringList pendingFiles;
+    QList<QImage> pendingImages;
+    bool useAtlas = useGL && parser.isSet(atlasOption);
+    QStringList atlasFiles;
+    QList<QImage> atlasImages;
+    ImageDecoder decoder;
+    qint64 trafficBytes = 0;
+    int trafficCount = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < inputFiles.size(); i++) {
+        const QString& inputFile = inputFiles[i];
+
+        // the next images are decoded by other threads while this one is processed
+        decoder.prefetch(inputFiles.mid(i, decoder.getPrefetchCount()));
+        DecodedImage decoded = decoder.take(inputFile);
+        if(decoded.image.isNull()) {
+            err << "cannot read " << inputFile << ": " << decoded.error << endl;
+            continue;
+        }
+        QImage image = decoded.image;
+        bool tiled = tileSize > 0 || image.width() > maxTextureSize || image.height() > maxTextureSize;
+
+        // the images are gathered until their atlas is full or an image of another size comes,
+        // the atlas is rendered once the pending renders are done
+        if(useAtlas && !tiled && !ImageProcessor::isDeepImage(image) && processor.atlasCapacity(image.size(), pipeline) > 1) {
+            while(processor.getPendingRenderCount() > 0) {
+                finishImage(pendingFiles.takeFirst(), pendingImages.takeFirst(), processor.takeRenderedImage());
+            }
+            if(!atlasImages.isEmpty() && atlasImages[0].size() != image.size()) {
+                finishAtlas(processor, atlasFiles, atlasImages);
+            }
+            atlasFiles.append(inputFile);
+            atlasImages.append(image);
+            if(atlasImages.size() >= processor.atlasCapacity(image.size(), pipeline)) {
+                finishAtlas(processor, atlasFiles, atlasImages);
+            }
+            continue;
+        }
+
+        // the output has the size of the image, its target is only reallocated when the size changes
+        // one render is read back while the next image is decoded and uploaded
+        if(useGL && !tiled) {
+            processor.loadImage(image);
+            processor.startRender(pipeline);
+            trafficBytes += processor.getFrameTraffic(pipeline);
+            trafficCount++;
+            pendingFiles.append(inputFile);
+            pendingImages.append(image);
+            if(processor.getPendingRenderCount() > 1) {
+                finishImage(pendingFiles.takeFirst(), pendingImages.takeFirst(), processor.takeRenderedImage());
+            }
+            continue;
+        }
+
+        // the other paths wait for the pending renders and the gathered images
+        while(processor.getPendingRenderCount() > 0) {
+            finishImage(pendingFiles.takeFirst(), pendingImages.takeFirst(), processor.takeRenderedImage());
+        }
+        if(!atlasImages.isEmpty()) {
+            finishAtlas(processor, atlasFiles, atlasImages);
+        }
+
+        // the tiles have an apron of the pipeline's radius, only their center is kept
+        if(useGL) {
+            finishImage(inputFile, image, processor.processTiled(image, pipeline, tileSize > 0 ? tileSize : ImageProcessor::DEFAULT_TILE_SIZE));
+        } else {
+            finishImage(inputFile, image, cpuProcessor.process(image, pipeline));
+        }
+    }
+
+    // the last renders
+    while(processor.getPendingRenderCount() > 0) {
+        finishImage(pendingFiles.takeFirst(), pendingImages.takeFirst(), processor.takeRenderedImage());
+    }
+    if(!atlasImages.isEmpty()) {
+        finishAtlas(processor, atlasFiles, atlasImages);
+    }
+    double seconds = timer.elapsed() / 1000.0;
+
+    // reporting the throughput
+    out << QString("%1 images processed in %2 s (%3 images/s)")
+           .arg(processedCount)
+           .arg(seconds, 0, 'f', 3)
+           .arg(seconds > 0.0 ? processedCount / seconds : 0.0, 0, 'f', 2) << endl;
+    if(validate) {
+        out << QString("%1 images out of the %2 tolerance").arg(invalidCount).arg(tolerance) << endl;
+    }
+
+    // the linear precision doubles the size of the intermediate targets and of the bytes the passes move
+    if(useGL) {
+        out << QString("Precision %1: %2 MB of textures, %3 MB moved per image")
+               .arg(ImageProcessor::precisionName(precision))
+               .arg(processor.getTextureMemory() / (1024.0 * 1024.0), 0, 'f', 1)
+               .arg(trafficCount > 0 ? trafficBytes / (1024.0 * 1024.0) / trafficCount : 0.0, 0, 'f', 1) << endl;
+    }
+
+    // every render has been read back, so the gpu is done with every timing
+    if(processor.isTimingEnabled()) {
+        processor.getPassTimer().collect();
+        out << processor.getPassTimer().getSummary() << endl;
+        QFile timingsFile(parser.value(timingsOption));
+        if(timingsFile.open(QIODevice::WriteOnly)) {
+            timingsFile.write(QJsonDocument(processor.getPassTimer().toJson()).toJson());
+        } else {
+            err << "cannot write " << timingsFile.fileName() << endl;
+        }
+    }
+    return (processedCount == inputFiles.size() && invalidCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#ifndef BATCHPROCESSOR_H
+#define BATCHPROCESSOR_H
+
+#include <QDir>
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include "filterstage.h"
+#include "cpuprocessor.h"
+#include "imageprocessor.h"
+
+/**
+ * The command line mode of the application.
+ * Runs the filter pipeline on a file or on every image of a directory,
+ * in an offscreen opengl context or on the cpu, without any window.
+ */
+class BatchProcessor
+{
+private:
+    QList<FilterStage> pipeline;
+    QStringList listImages(const QString& path) const;
+
+    // where the results go and how they are checked
+    CpuProcessor cpuProcessor;
+    QDir outputDirectory;
+    bool validate;
+    int tolerance;
+    int processedCount;
+    int invalidCount;
+    void finishImage(const QString& inputFile, const QImage& image, const QImage& result);
+    void finishAtlas(ImageProcessor& processor, QStringList& inputFiles, QList<QImage>& images);
+    static int compareImages(const QImage& first, const QImage& second, int tolerance, int& maxDifference);
+
+public:
+    static bool isRequested(int argc, char *argv[]);
+    static bool parseFilter(const QString& description, FilterStage& stage, QString& error);
+
+    int run(const QStringList& arguments);
+};
+
+#endif // BATCHPROCESSOR_H
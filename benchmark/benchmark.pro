@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# Measures the throughput of the filters offscreen,
+# shares the opengl side and the shaders of the application
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = filter_benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    filterbenchmark.cpp \
+    ../imageprocessor.cpp \
+    ../passtimer.cpp \
+    ../programcache.cpp
+
+HEADERS  += filterbenchmark.h \
+    ../filterstage.h \
+    ../imageprocessor.h \
+    ../passtimer.h \
+    ../programcache.h
+
+RESOURCES += \
+    ../shaders.qrc
+
+CONFIG += c++11
@@ -0,0 +1,359 @@
+#include "filterbenchmark.h"
+#include "imageprocessor.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QTextStream>
+#include <algorithm>
+
+const int FilterBenchmark::DEFAULT_SIZES[5] = { 512, 1024, 2048, 4096, 8192 };
+const int FilterBenchmark::DEFAULT_REPEAT_COUNT;
+const int FilterBenchmark::DEFAULT_WARMUP_COUNT;
+
+/**
+ * @brief FilterBenchmark::FilterBenchmark
+ */
+FilterBenchmark::FilterBenchmark() {
+    for(int size : DEFAULT_SIZES) {
+        sizes << size;
+    }
+    repeatCount = DEFAULT_REPEAT_COUNT;
+    warmupCount = DEFAULT_WARMUP_COUNT;
+}
+
+/**
+ * Lists the stages to measure: every algorithm with kernel sizes from 3 to 9
+ * and several deviations and ranges.
+ * The quick list only keeps the smallest and the biggest kernels with one deviation and one range.
+ *
+ * @brief FilterBenchmark::createCases
+ * @param quick
+ * @return the cases, named as in the --filter option of the batch mode
+ */
+QList<BenchmarkCase> FilterBenchmark::createCases(bool quick) {
+    static const char* gbAlgorithms[2] = { "separable", "2d" };
+    static const char* bfAlgorithms[2] = { "exact", "grid" };
+    static const char* edAlgorithms[4] = { "log", "sobel", "prewitt", "canny" };
+
+    QList<int> kernelSizes = quick ? QList<int>() << 3 << 9 : QList<int>() << 3 << 5 << 7 << 9;
+    QList<float> deviations = quick ? QList<float>() << 1.0f : QList<float>() << 1.0f << 3.0f;
+    QList<float> ranges = quick ? QList<float>() << 0.1f : QList<float>() << 0.1f << 0.3f;
+    QList<float> scaleFactors = quick ? QList<float>() << 2.0f : QList<float>() << 1.0f << 2.0f;
+
+    QList<BenchmarkCase> cases;
+    BenchmarkCase benchmarkCase;
+
+    // gaussian blur
+    for(int algorithm = 0; algorithm < 2; algorithm++) {
+        for(int kernelSize : kernelSizes) {
+            for(float deviation : deviations) {
+                benchmarkCase.stage = FilterStage(GAUSSIAN_BLUR);
+                benchmarkCase.stage.algorithm = algorithm;
+                benchmarkCase.stage.kernelSize = kernelSize;
+                benchmarkCase.stage.deviation = deviation;
+                benchmarkCase.name = QString("gaussian:algo=%1,k=%2,sigma=%3")
+                        .arg(gbAlgorithms[algorithm]).arg(kernelSize).arg(deviation);
+                cases << benchmarkCase;
+            }
+        }
+    }
+
+    // the boxes read from a summed-area table, whose cost should not depend on their size
+    QList<int> boxSizes = quick ? QList<int>() << 9 << 101 : QList<int>() << 9 << 31 << 101 << 301;
+    for(int kernelSize : boxSizes) {
+        benchmarkCase.stage = FilterStage(GAUSSIAN_BLUR);
+        benchmarkCase.stage.algorithm = ImageProcessor::BOX_ALGORITHM;
+        benchmarkCase.stage.kernelSize = kernelSize;
+        benchmarkCase.name = QString("gaussian:algo=box,k=%1").arg(kernelSize);
+        cases << benchmarkCase;
+    }
+    QList<float> boxDeviations = quick ? QList<float>() << 3.0f << 50.0f : QList<float>() << 3.0f << 10.0f << 50.0f;
+    for(float deviation : boxDeviations) {
+        benchmarkCase.stage = FilterStage(GAUSSIAN_BLUR);
+        benchmarkCase.stage.algorithm = ImageProcessor::BOX_GAUSSIAN_ALGORITHM;
+        benchmarkCase.stage.deviation = deviation;
+        benchmarkCase.name = QString("gaussian:algo=boxgauss,sigma=%1").arg(deviation);
+        cases << benchmarkCase;
+    }
+
+    // bilateral filter
+    for(int algorithm = 0; algorithm < 2; algorithm++) {
+        for(int kernelSize : kernelSizes) {
+            for(float deviation : deviations) {
+                for(float range : ranges) {
+                    benchmarkCase.stage = FilterStage(BILATERAL_FILTER);
+                    benchmarkCase.stage.algorithm = algorithm;
+                    benchmarkCase.stage.kernelSize = kernelSize;
+                    benchmarkCase.stage.deviation = deviation;
+                    benchmarkCase.stage.range = range;
+                    benchmarkCase.name = QString("bilateral:algo=%1,k=%2,sigma=%3,range=%4")
+                            .arg(bfAlgorithms[algorithm]).arg(kernelSize).arg(deviation).arg(range);
+                    cases << benchmarkCase;
+                }
+            }
+        }
+    }
+
+    // sharpening
+    for(float scaleFactor : scaleFactors) {
+        benchmarkCase.stage = FilterStage(SHARPENING);
+        benchmarkCase.stage.scaleFactor = scaleFactor;
+        benchmarkCase.name = QString("sharpening:scale=%1").arg(scaleFactor);
+        cases << benchmarkCase;
+    }
+
+    // edge detection
+    for(int algorithm = 0; algorithm < 4; algorithm++) {
+        benchmarkCase.stage = FilterStage(EDGE_DETECTION);
+        benchmarkCase.stage.algorithm = algorithm;
+        benchmarkCase.name = QString("edge:algo=%1").arg(edAlgorithms[algorithm]);
+        cases << benchmarkCase;
+    }
+    return cases;
+}
+
+/**
+ * Generates a square image with flat areas, sharp edges and noise,
+ * so that the bilateral filter and the edge detection meet all of them.
+ * The noise comes from a xorshift generator with a fixed seed.
+ *
+ * @brief FilterBenchmark::createImage
+ * @param size
+ * @return the image, in QImage::Format_RGBA8888
+ */
+QImage FilterBenchmark::createImage(int size) {
+    QImage image(size, size, QImage::Format_RGBA8888);
+    quint32 state = 2463534242u;
+    int cellSize = qMax(1, size / 16);
+    for(int y = 0; y < size; y++) {
+        uchar* line = image.scanLine(y);
+        for(int x = 0; x < size; x++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            // a checkerboard of gradients, with some noise on top of it
+            bool dark = ((x / cellSize) + (y / cellSize)) % 2 == 0;
+            int base = dark ? 48 : 192;
+            int noise = (int)(state % 33) - 16;
+            line[4*x] = (uchar)qBound(0, base + (x % cellSize) * 32 / cellSize + noise, 255);
+            line[4*x + 1] = (uchar)qBound(0, base + (y % cellSize) * 32 / cellSize + noise, 255);
+            line[4*x + 2] = (uchar)qBound(0, base + noise, 255);
+            line[4*x + 3] = 255;
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief FilterBenchmark::percentile
+ * @param values
+ * @param fraction between 0 and 1, 0.5 for the median
+ * @return the nearest value at this rank
+ */
+double FilterBenchmark::percentile(QList<double> values, double fraction) {
+    if(values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    int index = qBound(0, (int)(fraction * (values.size() - 1) + 0.5), values.size() - 1);
+    return values[index];
+}
+
+/**
+ * Gets the most memory the process has used so far.
+ *
+ * @brief FilterBenchmark::getPeakResidentMemory
+ * @return the size in bytes, 0 when it cannot be known
+ */
+qint64 FilterBenchmark::getPeakResidentMemory() {
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if(status.open(QIODevice::ReadOnly)) {
+        for(const QByteArray& line : status.readAll().split('\n')) {
+            if(line.startsWith("VmHWM:")) {
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Runs the benchmark.
+ * Creates an offscreen context, which can be a software one such as Mesa llvmpipe.
+ * Each case is rendered a few times to warm up, then measured until the gpu is done with each render.
+ *
+ * @brief FilterBenchmark::run
+ * @param arguments
+ * @return the exit code of the application
+ */
+int FilterBenchmark::run(const QStringList& arguments) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // declaring the options
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the throughput of every filter on synthetic images.\n"
+                                     "Without a display, run with -platform offscreen,\n"
+                                     "LIBGL_ALWAYS_SOFTWARE=1 forces the Mesa software renderer.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "The sizes of the square images, 512,1024,2048,4096,8192 by default.", "list");
+    QCommandLineOption repeatOption("repeat", "The number of measured renders of each case.", "count",
+                                    QString::number(DEFAULT_REPEAT_COUNT));
+    QCommandLineOption warmupOption("warmup", "The number of renders before measuring each case.", "count",
+                                    QString::number(DEFAULT_WARMUP_COUNT));
+    QCommandLineOption matchOption("match", "Only measures the cases whose name contains this text.", "text");
+    QCommandLineOption quickOption("quick", "Only measures the smallest and the biggest kernels with one deviation and one range.");
+    QCommandLineOption precisionsOption("precisions", "The precisions measured, gamma8 by default, "
+                                        "gamma8,linear16f compares the 8 bits passes to the linear half floats ones.", "list");
+    QCommandLineOption noComputeOption("no-compute", "Measures the fragment shaders of the filters having compute shaders too.");
+    QCommandLineOption outOption("out", "The json file receiving the results, the standard output by default.", "file");
+    parser.addOption(sizesOption);
+    parser.addOption(repeatOption);
+    parser.addOption(warmupOption);
+    parser.addOption(matchOption);
+    parser.addOption(quickOption);
+    parser.addOption(precisionsOption);
+    parser.addOption(noComputeOption);
+    parser.addOption(outOption);
+    parser.process(arguments);
+
+    if(parser.isSet(sizesOption)) {
+        sizes.clear();
+        for(const QString& size : parser.value(sizesOption).split(',', QString::SkipEmptyParts)) {
+            sizes << size.toInt();
+        }
+    }
+    repeatCount = qMax(1, parser.value(repeatOption).toInt());
+    warmupCount = qMax(0, parser.value(warmupOption).toInt());
+    QList<BenchmarkCase> cases = createCases(parser.isSet(quickOption));
+    QList<ImageProcessor::Precision> precisions;
+    for(const QString& name : parser.value(precisionsOption).split(',', QString::SkipEmptyParts)) {
+        if(name == ImageProcessor::precisionName(ImageProcessor::LINEAR_FLOAT16)) {
+            precisions << ImageProcessor::LINEAR_FLOAT16;
+        } else if(name == ImageProcessor::precisionName(ImageProcessor::GAMMA_8BIT)) {
+            precisions << ImageProcessor::GAMMA_8BIT;
+        } else {
+            err << "unknown precision " << name << endl;
+            return 1;
+        }
+    }
+    if(precisions.isEmpty()) {
+        precisions << ImageProcessor::GAMMA_8BIT;
+    }
+
+    // creating the offscreen context, the shaders need opengl 3.3
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    if(!context.create() || !context.makeCurrent(&surface)) {
+        err << "cannot create an OpenGL 3.3 context" << endl;
+        return 1;
+    }
+    QOpenGLFunctions* gl = context.functions();
+    QString renderer((const char*)gl->glGetString(GL_RENDERER));
+    err << "OpenGL renderer: " << renderer << endl;
+
+    // creating the shaders and the quad
+    ImageProcessor processor;
+    processor.initialize();
+    processor.setComputeEnabled(!parser.isSet(noComputeOption));
+    int maxTextureSize = processor.getMaxTextureSize();
+
+    QJsonArray results;
+    // the images are loaded again in each precision
+    for(ImageProcessor::Precision precision : precisions) {
+        processor.setPrecision(precision);
+        for(int size : sizes) {
+            if(size <= 0 || size > maxTextureSize) {
+                err << "skipping " << size << "x" << size << ", the biggest texture is " << maxTextureSize << endl;
+                continue;
+            }
+
+            // the image and the output stay the same for every case of this size
+            processor.loadImage(createImage(size));
+            QOpenGLFramebufferObject output(size, size);
+            double megapixels = (double)size * size / 1000000.0;
+
+            for(const BenchmarkCase& benchmarkCase : cases) {
+                if(parser.isSet(matchOption) && !benchmarkCase.name.contains(parser.value(matchOption))) {
+                    continue;
+                }
+                QList<FilterStage> pipeline;
+                pipeline << benchmarkCase.stage;
+
+                // the first renders compile the shaders' variants and allocate the intermediate textures
+                for(int i = 0; i < warmupCount; i++) {
+                    processor.render(pipeline, output.handle(), size, size);
+                }
+                gl->glFinish();
+
+                // measuring each render until the gpu is done with it
+                QList<double> milliseconds;
+                QElapsedTimer timer;
+                for(int i = 0; i < repeatCount; i++) {
+                    timer.start();
+                    processor.render(pipeline, output.handle(), size, size);
+                    gl->glFinish();
+                    milliseconds << timer.nsecsElapsed() / 1000000.0;
+                }
+
+                double median = percentile(milliseconds, 0.5);
+                QJsonObject result;
+                result["filter"] = benchmarkCase.name;
+                result["width"] = size;
+                result["height"] = size;
+                result["medianMilliseconds"] = median;
+                result["p95Milliseconds"] = percentile(milliseconds, 0.95);
+                result["megapixelsPerSecond"] = median > 0.0 ? megapixels / (median / 1000.0) : 0.0;
+                result["precision"] = ImageProcessor::precisionName(precision);
+                result["textureBytes"] = (double)(processor.getTextureMemory() + 4LL * size * size);
+                result["trafficBytes"] = (double)processor.getFrameTraffic(pipeline);
+                result["peakResidentBytes"] = (double)getPeakResidentMemory();
+                results.append(result);
+
+                err << QString("%1 %2 %3x%3: %4 ms median, %5 MP/s")
+                       .arg(benchmarkCase.name, -50).arg(ImageProcessor::precisionName(precision), -9).arg(size)
+                       .arg(median, 0, 'f', 2)
+                       .arg(result["megapixelsPerSecond"].toDouble(), 0, 'f', 1) << endl;
+            }
+        }
+    }
+
+    // the results, with what they have been measured with
+    QJsonObject report;
+    report["vendor"] = QString((const char*)gl->glGetString(GL_VENDOR));
+    report["renderer"] = renderer;
+    report["version"] = QString((const char*)gl->glGetString(GL_VERSION));
+    report["repeat"] = repeatCount;
+    report["warmup"] = warmupCount;
+    report["computeShaders"] = processor.isComputeAvailable() && processor.isComputeEnabled();
+    report["results"] = results;
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if(!parser.isSet(outOption)) {
+        out << json;
+        return 0;
+    }
+    QFile file(parser.value(outOption));
+    if(!file.open(QIODevice::WriteOnly)) {
+        err << "cannot write " << file.fileName() << endl;
+        return 1;
+    }
+    file.write(json);
+    return 0;
+}
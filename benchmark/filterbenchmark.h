@@ -0,0 +1,47 @@
+#ifndef FILTERBENCHMARK_H
+#define FILTERBENCHMARK_H
+
+#include <QImage>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "filterstage.h"
+
+/**
+ * A stage to measure, and the name it has in the --filter syntax of the batch mode.
+ */
+struct BenchmarkCase {
+    QString name;
+    FilterStage stage;
+};
+
+/**
+ * Measures the throughput of every algorithm in an offscreen context.
+ * Sweeps the algorithms and their parameters over synthetic images of several sizes,
+ * and writes the median and 95th percentile times as json, so that two commits can be diffed.
+ * The images are generated with a fixed seed: every run measures the same pixels.
+ */
+class FilterBenchmark
+{
+private:
+    QList<int> sizes;
+    int repeatCount;
+    int warmupCount;
+
+    static QList<BenchmarkCase> createCases(bool quick);
+    static QImage createImage(int size);
+    static double percentile(QList<double> values, double fraction);
+    static qint64 getPeakResidentMemory();
+
+public:
+    // the sizes of the images measured by default, from 512x512 to 8192x8192
+    static const int DEFAULT_SIZES[5];
+    static const int DEFAULT_REPEAT_COUNT = 9;
+    static const int DEFAULT_WARMUP_COUNT = 2;
+
+    FilterBenchmark();
+    int run(const QStringList& arguments);
+};
+
+#endif // FILTERBENCHMARK_H
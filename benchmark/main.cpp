@@ -0,0 +1,9 @@
+#include "filterbenchmark.h"
+#include <QGuiApplication>
+
+int main(int argc, char *argv[])
+{
+    // the offscreen context only needs the gui application
+    QGuiApplication a(argc, argv);
+    return FilterBenchmark().run(a.arguments());
+}
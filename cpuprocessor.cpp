@@ -0,0 +1,718 @@
+#include "cpuprocessor.h"
+#include "imageprocessor.h"
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+// the intrinsics are only used on x86 with compilers allowing them per function
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define CPU_PROCESSOR_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+#endif
+
+#if defined(CPU_PROCESSOR_SIMD) && defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX __attribute__((target("avx")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX
+#endif
+
+namespace {
+
+/**
+ * Sums the neighbors of every pixel of a row times their weight, one channel at a time.
+ */
+void convolveRowScalar(const float* center, int width, const int* offsets, const float* weights, int tapCount, float* out) {
+    for(int x = 0; x < width; x++) {
+        const float* pixel = center + 4*x;
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(int t = 0; t < tapCount; t++) {
+            const float* neighbor = pixel + offsets[t];
+            for(int c = 0; c < 4; c++) {
+                sum[c] += neighbor[c] * weights[t];
+            }
+        }
+        for(int c = 0; c < 4; c++) {
+            out[4*x + c] = sum[c];
+        }
+    }
+}
+
+/**
+ * Same as convolveRowScalar with the closeness term of the bilateral filter.
+ */
+void bilateralRowScalar(const float* center, int width, const int* offsets, const float* weights, int tapCount,
+                        float inverseRange, float* out) {
+    for(int x = 0; x < width; x++) {
+        const float* pixel = center + 4*x;
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for(int t = 0; t < tapCount; t++) {
+            const float* neighbor = pixel + offsets[t];
+            float closeness = 0.0f;
+            for(int c = 0; c < 4; c++) {
+                float difference = neighbor[c] - pixel[c];
+                closeness += difference * difference;
+            }
+            float weight = weights[t] * std::exp(-closeness * inverseRange);
+            for(int c = 0; c < 4; c++) {
+                sum[c] += neighbor[c] * weight;
+            }
+        }
+        for(int c = 0; c < 4; c++) {
+            out[4*x + c] = sum[c];
+        }
+    }
+}
+
+#ifdef CPU_PROCESSOR_SIMD
+
+/**
+ * One pixel, the four channels at once, per SSE2 register.
+ */
+TARGET_SSE2 void convolveRowSse2(const float* center, int width, const int* offsets, const float* weights, int tapCount, float* out) {
+    for(int x = 0; x < width; x++) {
+        const float* pixel = center + 4*x;
+        __m128 sum = _mm_setzero_ps();
+        for(int t = 0; t < tapCount; t++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixel + offsets[t]), _mm_set1_ps(weights[t])));
+        }
+        _mm_storeu_ps(out + 4*x, sum);
+    }
+}
+
+TARGET_SSE2 void bilateralRowSse2(const float* center, int width, const int* offsets, const float* weights, int tapCount,
+                                  float inverseRange, float* out) {
+    for(int x = 0; x < width; x++) {
+        const float* pixel = center + 4*x;
+        __m128 original = _mm_loadu_ps(pixel);
+        __m128 sum = _mm_setzero_ps();
+        for(int t = 0; t < tapCount; t++) {
+            __m128 neighbor = _mm_loadu_ps(pixel + offsets[t]);
+
+            // squared distance between the colors, summed horizontally
+            __m128 difference = _mm_sub_ps(neighbor, original);
+            __m128 squares = _mm_mul_ps(difference, difference);
+            __m128 shuffled = _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1));
+            __m128 sums = _mm_add_ps(squares, shuffled);
+            shuffled = _mm_movehl_ps(shuffled, sums);
+            float closeness = _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+
+            float weight = weights[t] * std::exp(-closeness * inverseRange);
+            sum = _mm_add_ps(sum, _mm_mul_ps(neighbor, _mm_set1_ps(weight)));
+        }
+        _mm_storeu_ps(out + 4*x, sum);
+    }
+}
+
+/**
+ * Two neighboring pixels per AVX register, the last odd pixel goes through SSE2.
+ */
+TARGET_AVX void convolveRowAvx(const float* center, int width, const int* offsets, const float* weights, int tapCount, float* out) {
+    int x = 0;
+    for(; x + 1 < width; x += 2) {
+        const float* pixel = center + 4*x;
+        __m256 sum = _mm256_setzero_ps();
+        for(int t = 0; t < tapCount; t++) {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(pixel + offsets[t]), _mm256_set1_ps(weights[t])));
+        }
+        _mm256_storeu_ps(out + 4*x, sum);
+    }
+    if(x < width) {
+        convolveRowSse2(center + 4*x, width - x, offsets, weights, tapCount, out + 4*x);
+    }
+}
+
+TARGET_AVX void bilateralRowAvx(const float* center, int width, const int* offsets, const float* weights, int tapCount,
+                                  float inverseRange, float* out) {
+    int x = 0;
+    for(; x + 1 < width; x += 2) {
+        const float* pixel = center + 4*x;
+        __m256 original = _mm256_loadu_ps(pixel);
+        __m256 sum = _mm256_setzero_ps();
+        for(int t = 0; t < tapCount; t++) {
+            __m256 neighbor = _mm256_loadu_ps(pixel + offsets[t]);
+
+            // squared distances between the colors, summed horizontally in each half
+            __m256 difference = _mm256_sub_ps(neighbor, original);
+            __m256 squares = _mm256_mul_ps(difference, difference);
+            __m256 sums = _mm256_hadd_ps(squares, squares);
+            sums = _mm256_hadd_ps(sums, sums);
+            float closeness0 = _mm_cvtss_f32(_mm256_castps256_ps128(sums));
+            float closeness1 = _mm_cvtss_f32(_mm256_extractf128_ps(sums, 1));
+
+            __m128 weight0 = _mm_set1_ps(weights[t] * std::exp(-closeness0 * inverseRange));
+            __m128 weight1 = _mm_set1_ps(weights[t] * std::exp(-closeness1 * inverseRange));
+            __m256 weight = _mm256_insertf128_ps(_mm256_castps128_ps256(weight0), weight1, 1);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(neighbor, weight));
+        }
+        _mm256_storeu_ps(out + 4*x, sum);
+    }
+    if(x < width) {
+        bilateralRowSse2(center + 4*x, width - x, offsets, weights, tapCount, inverseRange, out + 4*x);
+    }
+}
+
+#endif // CPU_PROCESSOR_SIMD
+
+/**
+ * Rounds a value the way it is stored in a 8 bits render target.
+ */
+inline float quantize(float value) {
+    return std::floor(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f) / 255.0f;
+}
+
+}
+
+/**
+ * By default the best instruction set of the host is used, with one thread per core.
+ *
+ * @brief CpuProcessor::CpuProcessor
+ */
+CpuProcessor::CpuProcessor() {
+    instructionSet = supportedInstructionSet();
+    threadCount = QThread::idealThreadCount();
+}
+
+/**
+ * Detects the best instruction set the host can run.
+ *
+ * @brief CpuProcessor::supportedInstructionSet
+ * @return the instruction set
+ */
+CpuProcessor::InstructionSet CpuProcessor::supportedInstructionSet() {
+#if defined(CPU_PROCESSOR_SIMD) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx")) {
+        return AVX;
+    }
+    if(__builtin_cpu_supports("sse2")) {
+        return SSE2;
+    }
+#elif defined(CPU_PROCESSOR_SIMD) && defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 1);
+    bool sse2 = (registers[3] & (1 << 26)) != 0;
+    bool osAvx = (registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0
+            && (_xgetbv(0) & 0x6) == 0x6;
+    if(osAvx) {
+        return AVX;
+    }
+    if(sse2) {
+        return SSE2;
+    }
+#endif
+    return SCALAR;
+}
+
+/**
+ * @brief CpuProcessor::instructionSetName
+ * @param instructionSet
+ * @return the readable name of the instruction set
+ */
+QString CpuProcessor::instructionSetName(InstructionSet instructionSet) {
+    switch(instructionSet) {
+    case SSE2:
+        return "SSE2";
+    case AVX:
+        return "AVX";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief CpuProcessor::getInstructionSet
+ * @return the instruction set used by the kernels
+ */
+CpuProcessor::InstructionSet CpuProcessor::getInstructionSet() const {
+    return instructionSet;
+}
+
+/**
+ * Chooses the instruction set used by the kernels.
+ * It is lowered to the best one the host supports.
+ *
+ * @brief CpuProcessor::setInstructionSet
+ * @param instructionSet
+ */
+void CpuProcessor::setInstructionSet(InstructionSet instructionSet) {
+    this->instructionSet = std::min(instructionSet, supportedInstructionSet());
+}
+
+/**
+ * @brief CpuProcessor::getThreadCount
+ * @return the number of bands of rows processed in parallel
+ */
+int CpuProcessor::getThreadCount() const {
+    return threadCount;
+}
+
+/**
+ * @brief CpuProcessor::setThreadCount
+ * @param threadCount the number of bands of rows processed in parallel
+ */
+void CpuProcessor::setThreadCount(int threadCount) {
+    this->threadCount = std::max(1, threadCount);
+}
+
+/**
+ * Runs the pipeline on an image.
+ * The result has the rgba bytes the opengl path would read back, from top to bottom.
+ *
+ * @brief CpuProcessor::process
+ * @param image
+ * @param pipeline
+ * @return the processed image, in QImage::Format_RGBA8888
+ */
+QImage CpuProcessor::process(const QImage& image, const QList<FilterStage>& pipeline) const {
+
+    // getting the image as normalized floats, like a texture
+    QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+    FloatImage current;
+    current.width = rgba.width();
+    current.height = rgba.height();
+    current.pixels.resize(4 * current.width * current.height);
+    for(int y = 0; y < current.height; y++) {
+        const uchar* line = rgba.constScanLine(y);
+        for(int x = 0; x < 4 * current.width; x++) {
+            current.pixels[4 * current.width * y + x] = line[x] / 255.0f;
+        }
+    }
+
+    // running every pass of every stage
+    FloatImage next;
+    for(const FilterStage& stage : pipeline) {
+        std::vector<Pass> passes;
+        buildPasses(stage, passes);
+        for(const Pass& pass : passes) {
+            runPass(pass, current, next);
+            std::swap(current, next);
+        }
+    }
+
+    // getting the result back as bytes
+    QImage result(current.width, current.height, QImage::Format_RGBA8888);
+    for(int y = 0; y < current.height; y++) {
+        uchar* line = result.scanLine(y);
+        for(int x = 0; x < 4 * current.width; x++) {
+            line[x] = (uchar)(quantize(current.pixels[4 * current.width * y + x]) * 255.0f + 0.5f);
+        }
+    }
+    return result;
+}
+
+/**
+ * Translates a stage into the passes its shaders run, with the same kernels.
+ *
+ * @brief CpuProcessor::buildPasses
+ * @param stage
+ * @param passes
+ */
+void CpuProcessor::buildPasses(const FilterStage& stage, std::vector<Pass>& passes) const {
+    if(stage.type == EDGE_DETECTION && stage.algorithm == ImageProcessor::CANNY_ALGORITHM) {
+        buildCannyPasses(stage, passes);
+        return;
+    }
+
+    for(int index = 0; index < ImageProcessor::passCount(stage); index++) {
+        Pass pass;
+        pass.radius = 1;
+        pass.bilateral = false;
+        pass.range = stage.range;
+        pass.scaleFactor = stage.scaleFactor;
+        pass.finish = FINISH_NONE;
+        pass.orientation = false;
+        pass.lowThreshold = stage.lowThreshold;
+        pass.highThreshold = stage.highThreshold;
+        pass.lastPass = false;
+        pass.boxRadius = -1;
+
+        // the 3x3 kernels are laid out from the upper left corner to the bottom right corner
+        float kernel3x3[9] = { 0.0f };
+        bool is3x3 = true;
+
+        switch(stage.type) {
+        case GAUSSIAN_BLUR:
+        case BILATERAL_FILTER:
+            is3x3 = false;
+            if(stage.type == GAUSSIAN_BLUR && stage.algorithm >= ImageProcessor::BOX_ALGORITHM) {
+
+                // the boxes need no padding, they stop at the edges
+                int radii[ImageProcessor::BOX_GAUSSIAN_PASSES];
+                ImageProcessor::calculateBoxRadii(stage.deviation, radii);
+                pass.radius = 0;
+                pass.boxRadius = (stage.algorithm == ImageProcessor::BOX_ALGORITHM)
+                        ? std::min(stage.kernelSize, (int)ImageProcessor::MAX_BOX_KERNEL_SIZE) / 2 : radii[index];
+            } else if(stage.type == GAUSSIAN_BLUR && stage.algorithm == 0) {
+
+                // the separable kernel goes through x then through y
+                int kernelSize = std::min(stage.kernelSize, (int)ImageProcessor::MAX_SEPARABLE_KERNEL_SIZE);
+                std::vector<float> kernel(kernelSize);
+                ImageProcessor::calculateKernel1D(kernel.data(), kernelSize, stage.deviation);
+                pass.radius = kernelSize / 2;
+                for(int i = 0; i < kernelSize; i++) {
+                    pass.dx.push_back(index == 0 ? i - kernelSize/2 : 0);
+                    pass.dy.push_back(index == 0 ? 0 : i - kernelSize/2);
+                    pass.weights.push_back(kernel[i]);
+                }
+            } else {
+
+                // the 2D kernel, from the upper left corner to the bottom right corner
+                int kernelSize = std::min(stage.kernelSize, (int)ImageProcessor::MAX_KERNEL_SIZE);
+                std::vector<float> kernel(kernelSize * kernelSize);
+                ImageProcessor::calculateKernel(kernel.data(), kernelSize, stage.deviation);
+                pass.radius = kernelSize / 2;
+                pass.bilateral = (stage.type == BILATERAL_FILTER);
+                int i = 0;
+                for(int y = kernelSize/2; y >= -kernelSize/2; y--) {
+                    for(int x = -kernelSize/2; x <= kernelSize/2; x++) {
+                        pass.dx.push_back(x);
+                        pass.dy.push_back(y);
+                        pass.weights.push_back(kernel[i]);
+                        i++;
+                    }
+                }
+            }
+            break;
+        case SHARPENING:
+            std::copy(ImageProcessor::SHARPENING_KERNEL, ImageProcessor::SHARPENING_KERNEL + 9, kernel3x3);
+            pass.finish = FINISH_SHARPENING;
+            break;
+        case EDGE_DETECTION:
+            ImageProcessor::calculateEdgeKernel(kernel3x3, stage.algorithm);
+            pass.finish = stage.algorithm > 0 ? FINISH_GRADIENT : FINISH_EDGE;
+            pass.scaleFactor = 1.0f;
+            break;
+        default:
+            kernel3x3[4] = 1.0f;
+            break;
+        }
+
+        if(is3x3) {
+            int i = 0;
+            for(int y = 1; y >= -1; y--) {
+                for(int x = -1; x <= 1; x++) {
+                    pass.dx.push_back(x);
+                    pass.dy.push_back(y);
+                    pass.weights.push_back(kernel3x3[i]);
+                    i++;
+                }
+            }
+
+            // the y kernel of the gradient is minus the transposed x kernel
+            if(pass.finish == FINISH_GRADIENT) {
+                for(int row = 0; row < 3; row++) {
+                    for(int column = 0; column < 3; column++) {
+                        pass.weightsY.push_back(-kernel3x3[3*column + row]);
+                    }
+                }
+            }
+        }
+        passes.push_back(pass);
+    }
+}
+
+/**
+ * Translates Canny into the passes of its shaders: the smoothing and the Sobel gradient with its direction
+ * are built like their own stages, the magnitude being normalized like the shader does, the suppression, the threshold and the hysteresis only read
+ * the neighbors they need.
+ *
+ * @brief CpuProcessor::buildCannyPasses
+ * @param stage
+ * @param passes
+ */
+void CpuProcessor::buildCannyPasses(const FilterStage& stage, std::vector<Pass>& passes) const {
+    FilterStage smoothing(GAUSSIAN_BLUR);
+    smoothing.kernelSize = ImageProcessor::CANNY_KERNEL_SIZE;
+    smoothing.deviation = ImageProcessor::CANNY_DEVIATION;
+    buildPasses(smoothing, passes);
+
+    FilterStage gradient(EDGE_DETECTION);
+    gradient.algorithm = 1;
+    buildPasses(gradient, passes);
+    passes.back().orientation = true;
+    passes.back().scaleFactor = ImageProcessor::CANNY_GRADIENT_SCALE;
+
+    Pass pass;
+    pass.radius = 1;
+    pass.bilateral = false;
+    pass.range = stage.range;
+    pass.scaleFactor = stage.scaleFactor;
+    pass.orientation = false;
+    pass.lowThreshold = stage.lowThreshold;
+    pass.highThreshold = stage.highThreshold;
+    pass.lastPass = false;
+    pass.boxRadius = -1;
+
+    pass.finish = FINISH_SUPPRESSION;
+    passes.push_back(pass);
+    pass.finish = FINISH_THRESHOLD;
+    passes.push_back(pass);
+    pass.finish = FINISH_HYSTERESIS;
+    for(int i = 0; i < ImageProcessor::CANNY_HYSTERESIS_PASSES; i++) {
+        pass.lastPass = (i == ImageProcessor::CANNY_HYSTERESIS_PASSES - 1);
+        passes.push_back(pass);
+    }
+}
+
+/**
+ * Runs a pass over the whole image.
+ * The source is padded with copies of its edges, as GL_CLAMP_TO_EDGE does,
+ * then the rows are split in bands processed in parallel.
+ *
+ * @brief CpuProcessor::runPass
+ * @param pass
+ * @param source
+ * @param target
+ */
+void CpuProcessor::runPass(const Pass& pass, const FloatImage& source, FloatImage& target) const {
+    if(pass.boxRadius >= 0) {
+        runBoxPass(pass, source, target);
+        return;
+    }
+
+    // padding the source
+    FloatImage padded;
+    padded.width = source.width + 2 * pass.radius;
+    padded.height = source.height + 2 * pass.radius;
+    padded.pixels.resize(4 * padded.width * padded.height);
+    for(int y = 0; y < padded.height; y++) {
+        int sourceY = std::min(std::max(y - pass.radius, 0), source.height - 1);
+        for(int x = 0; x < padded.width; x++) {
+            int sourceX = std::min(std::max(x - pass.radius, 0), source.width - 1);
+            const float* from = &source.pixels[4 * (sourceY * source.width + sourceX)];
+            std::copy(from, from + 4, &padded.pixels[4 * (y * padded.width + x)]);
+        }
+    }
+
+    // the target has the size of the source
+    target.width = source.width;
+    target.height = source.height;
+    target.pixels.resize(source.pixels.size());
+
+    // splitting the rows in bands
+    int bandCount = std::max(1, std::min(threadCount, source.height));
+    std::vector<std::thread> threads;
+    for(int band = 0; band < bandCount; band++) {
+        int firstRow = source.height * band / bandCount;
+        int lastRow = source.height * (band + 1) / bandCount;
+        threads.push_back(std::thread(&CpuProcessor::runBand, this, std::cref(pass), std::cref(padded),
+                                      std::cref(source), std::ref(target), firstRow, lastRow));
+    }
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Runs a box pass like its shader: the channels are converted to the integers of the 8 bits targets,
+ * summed into a table wrapping around like the 32 bits textures, and each box is read from the table
+ * and averaged over the pixels it covers in the image.
+ *
+ * @brief CpuProcessor::runBoxPass
+ * @param pass
+ * @param source
+ * @param target
+ */
+void CpuProcessor::runBoxPass(const Pass& pass, const FloatImage& source, FloatImage& target) const {
+    int width = source.width;
+    int height = source.height;
+    float scale = (float)ImageProcessor::SAT_GAMMA_SCALE;
+
+    // the table has a row and a column of zeros before the image
+    int tableWidth = width + 1;
+    std::vector<uint32_t> table(4 * tableWidth * (height + 1), 0);
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            for(int c = 0; c < 4; c++) {
+                float value = std::min(std::max(source.pixels[4 * (y * width + x) + c], 0.0f), 1.0f);
+                uint32_t sum = (uint32_t)std::floor(value * scale + 0.5f);
+                sum += table[4 * (y * tableWidth + x + 1) + c] + table[4 * ((y + 1) * tableWidth + x) + c]
+                        - table[4 * (y * tableWidth + x) + c];
+                table[4 * ((y + 1) * tableWidth + x + 1) + c] = sum;
+            }
+        }
+    }
+
+    // reading each box from its corners
+    target.width = width;
+    target.height = height;
+    target.pixels.resize(source.pixels.size());
+    for(int y = 0; y < height; y++) {
+        int low = std::max(y - pass.boxRadius, 0);
+        int high = std::min(y + pass.boxRadius, height - 1) + 1;
+        for(int x = 0; x < width; x++) {
+            int left = std::max(x - pass.boxRadius, 0);
+            int right = std::min(x + pass.boxRadius, width - 1) + 1;
+            float area = (float)((right - left) * (high - low));
+            for(int c = 0; c < 4; c++) {
+                uint32_t sum = table[4 * (high * tableWidth + right) + c] - table[4 * (high * tableWidth + left) + c]
+                        - table[4 * (low * tableWidth + right) + c] + table[4 * (low * tableWidth + left) + c];
+                target.pixels[4 * (y * width + x) + c] = quantize((float)sum / (area * scale));
+            }
+        }
+    }
+}
+
+/**
+ * Runs a pass over a band of rows with the chosen instruction set.
+ * Then finishes each pixel like the shader and quantizes it like the render target.
+ *
+ * @brief CpuProcessor::runBand
+ * @param pass
+ * @param padded the source padded with the radius of the pass
+ * @param source
+ * @param target
+ * @param firstRow
+ * @param lastRow excluded
+ */
+void CpuProcessor::runBand(const Pass& pass, const FloatImage& padded, const FloatImage& source,
+                           FloatImage& target, int firstRow, int lastRow) const {
+
+    // the offset of each neighbor in the padded source, y going up in the shaders
+    int stride = 4 * padded.width;
+    int tapCount = (int)pass.weights.size();
+    std::vector<int> offsets(tapCount);
+    for(int t = 0; t < tapCount; t++) {
+        offsets[t] = -pass.dy[t] * stride + 4 * pass.dx[t];
+    }
+    float inverseRange = 1.0f / (2.0f * pass.range * pass.range);
+
+    std::vector<float> row(4 * source.width);
+    std::vector<float> rowY(pass.finish == FINISH_GRADIENT ? 4 * source.width : 0);
+    for(int y = firstRow; y < lastRow; y++) {
+        const float* center = &padded.pixels[4 * ((y + pass.radius) * padded.width + pass.radius)];
+
+        // the weighted sum of the neighbors, and the one of the y kernel for a gradient
+        if(tapCount > 0) {
+            sumRow(pass, pass.weights, center, source.width, offsets.data(), inverseRange, row.data());
+        }
+        if(pass.finish == FINISH_GRADIENT) {
+            sumRow(pass, pass.weightsY, center, source.width, offsets.data(), inverseRange, rowY.data());
+        }
+
+        // finishing like the shaders and quantizing like the 8 bits targets
+        const float* original = &source.pixels[4 * source.width * y];
+        float* out = &target.pixels[4 * source.width * y];
+        for(int x = 0; x < source.width; x++) {
+            float* sum = &row[4*x];
+            if(pass.finish == FINISH_SHARPENING) {
+                for(int c = 0; c < 4; c++) {
+                    sum[c] = pass.scaleFactor * sum[c] + original[4*x + c];
+                }
+            } else if(pass.finish == FINISH_EDGE) {
+                sum[0] = std::max(std::max(sum[0], sum[1]), sum[2]);
+                sum[1] = sum[2] = sum[0];
+            } else if(pass.finish == FINISH_GRADIENT) {
+                float magnitudes[3];
+                int channel = 0;
+                for(int c = 0; c < 3; c++) {
+                    magnitudes[c] = std::sqrt(sum[c]*sum[c] + rowY[4*x + c]*rowY[4*x + c]);
+                    if(magnitudes[c] > magnitudes[channel]) {
+                        channel = c;
+                    }
+                }
+                float magnitude = magnitudes[channel];
+                float gx = sum[channel];
+                float gy = rowY[4*x + channel];
+                sum[0] = sum[1] = sum[2] = magnitude * pass.scaleFactor;
+                sum[3] = original[4*x + 3];
+                if(pass.orientation) {
+                    sum[1] = magnitude > 0.0f ? gx / magnitude * 0.5f + 0.5f : 0.5f;
+                    sum[2] = magnitude > 0.0f ? gy / magnitude * 0.5f + 0.5f : 0.5f;
+                }
+            } else if(pass.finish == FINISH_SUPPRESSION) {
+
+                // the neighbors along the direction rounded to the nearest of the 8 ones
+                const float* pixel = center + 4*x;
+                float directionX = pixel[1] * 2.0f - 1.0f;
+                float directionY = pixel[2] * 2.0f - 1.0f;
+                int stepX = std::fabs(directionX) > 0.3827f ? (directionX > 0.0f ? 1 : -1) : 0;
+                int stepY = std::fabs(directionY) > 0.3827f ? (directionY > 0.0f ? 1 : -1) : 0;
+                float forward = pixel[-stepY * stride + 4 * stepX];
+                float backward = pixel[stepY * stride - 4 * stepX];
+                float kept = (pixel[0] > forward && pixel[0] >= backward) ? pixel[0] : 0.0f;
+                sum[0] = sum[1] = sum[2] = kept;
+                sum[3] = pixel[3];
+            } else if(pass.finish == FINISH_THRESHOLD) {
+                const float* pixel = &original[4*x];
+                float edge = pixel[0] >= pass.highThreshold ? 1.0f : (pixel[0] >= pass.lowThreshold ? 0.5f : 0.0f);
+                sum[0] = sum[1] = sum[2] = edge;
+                sum[3] = pixel[3];
+            } else if(pass.finish == FINISH_HYSTERESIS) {
+
+                // a weak edge next to a strong one becomes strong
+                const float* pixel = center + 4*x;
+                float edge = pixel[0];
+                if(edge > 0.25f && edge < 0.75f) {
+                    for(int dy = -1; dy <= 1; dy++) {
+                        for(int dx = -1; dx <= 1; dx++) {
+                            if(pixel[-dy * stride + 4 * dx] > 0.75f) {
+                                edge = 1.0f;
+                            }
+                        }
+                    }
+                }
+                if(pass.lastPass) {
+                    edge = edge > 0.75f ? 1.0f : 0.0f;
+                }
+                sum[0] = sum[1] = sum[2] = edge;
+                sum[3] = pixel[3];
+            }
+            for(int c = 0; c < 4; c++) {
+                out[4*x + c] = quantize(sum[c]);
+            }
+        }
+    }
+}
+
+/**
+ * Sums the weighted neighbors of a row of pixels with the chosen instruction set.
+ *
+ * @brief CpuProcessor::sumRow
+ * @param pass
+ * @param weights the weight of each neighbor
+ * @param center the first pixel of the row in the padded source
+ * @param width
+ * @param offsets the offset of each neighbor in the padded source
+ * @param inverseRange
+ * @param row the sums
+ */
+void CpuProcessor::sumRow(const Pass& pass, const std::vector<float>& weights, const float* center, int width,
+                          const int* offsets, float inverseRange, float* row) const {
+    int tapCount = (int)weights.size();
+    switch(instructionSet) {
+#ifdef CPU_PROCESSOR_SIMD
+    case AVX:
+        if(pass.bilateral) {
+            bilateralRowAvx(center, width, offsets, weights.data(), tapCount, inverseRange, row);
+        } else {
+            convolveRowAvx(center, width, offsets, weights.data(), tapCount, row);
+        }
+        break;
+    case SSE2:
+        if(pass.bilateral) {
+            bilateralRowSse2(center, width, offsets, weights.data(), tapCount, inverseRange, row);
+        } else {
+            convolveRowSse2(center, width, offsets, weights.data(), tapCount, row);
+        }
+        break;
+#endif
+    default:
+        if(pass.bilateral) {
+            bilateralRowScalar(center, width, offsets, weights.data(), tapCount, inverseRange, row);
+        } else {
+            convolveRowScalar(center, width, offsets, weights.data(), tapCount, row);
+        }
+        break;
+    }
+}
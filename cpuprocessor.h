@@ -0,0 +1,96 @@
+#ifndef CPUPROCESSOR_H
+#define CPUPROCESSOR_H
+
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <vector>
+#include "filterstage.h"
+
+/**
+ * Runs the filter pipeline on the cpu, for hosts without a usable opengl context.
+ * Computes exactly what the shaders compute: same kernels, same clamping to the edges
+ * and same 8 bits quantization between the passes.
+ * The kernels are written with SSE2 and AVX intrinsics and run over bands of rows in several threads.
+ * The bilateral grid only approximates the bilateral filter, the cpu runs the exact filter for it.
+ */
+class CpuProcessor
+{
+public:
+    enum InstructionSet {
+        SCALAR,
+        SSE2,
+        AVX
+    };
+
+private:
+    InstructionSet instructionSet;
+    int threadCount;
+
+    /**
+     * An image with 4 floats per pixel, in rgba order, from top to bottom.
+     */
+    struct FloatImage {
+        int width;
+        int height;
+        std::vector<float> pixels;
+    };
+
+    /**
+     * What a pass does with the weighted sum of its neighbors.
+     */
+    enum Finish {
+        FINISH_NONE,
+        FINISH_SHARPENING,
+        FINISH_EDGE,
+        FINISH_GRADIENT,
+        FINISH_SUPPRESSION,
+        FINISH_THRESHOLD,
+        FINISH_HYSTERESIS
+    };
+
+    /**
+     * A pass of a stage, as computed by one draw of its shader.
+     * The taps are in the shaders' coords: x going right and y going up.
+     * A box pass has no taps, it reads a summed-area table like its shader.
+     */
+    struct Pass {
+        std::vector<int> dx;
+        std::vector<int> dy;
+        std::vector<float> weights;
+        std::vector<float> weightsY;
+        int radius;
+        bool bilateral;
+        float range;
+        float scaleFactor;
+        Finish finish;
+        bool orientation;
+        float lowThreshold;
+        float highThreshold;
+        bool lastPass;
+        int boxRadius;
+    };
+
+    void buildPasses(const FilterStage& stage, std::vector<Pass>& passes) const;
+    void buildCannyPasses(const FilterStage& stage, std::vector<Pass>& passes) const;
+    void runPass(const Pass& pass, const FloatImage& source, FloatImage& target) const;
+    void runBoxPass(const Pass& pass, const FloatImage& source, FloatImage& target) const;
+    void runBand(const Pass& pass, const FloatImage& padded, const FloatImage& source,
+                 FloatImage& target, int firstRow, int lastRow) const;
+    void sumRow(const Pass& pass, const std::vector<float>& weights, const float* center, int width,
+                const int* offsets, float inverseRange, float* row) const;
+
+public:
+    CpuProcessor();
+    static InstructionSet supportedInstructionSet();
+    static QString instructionSetName(InstructionSet instructionSet);
+
+    InstructionSet getInstructionSet() const;
+    void setInstructionSet(InstructionSet instructionSet);
+    int getThreadCount() const;
+    void setThreadCount(int threadCount);
+
+    QImage process(const QImage& image, const QList<FilterStage>& pipeline) const;
+};
+
+#endif // CPUPROCESSOR_H
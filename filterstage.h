@@ -0,0 +1,72 @@
+#ifndef FILTERSTAGE_H
+#define FILTERSTAGE_H
+
+/**
+ * The algorithms that can be chained in the filter pipeline.
+ */
+enum FilterType {
+    GAUSSIAN_BLUR,
+    BILATERAL_FILTER,
+    SHARPENING,
+    EDGE_DETECTION,
+    FILTER_TYPE_COUNT
+};
+
+/**
+ * A stage of the filter pipeline: the algorithm to run and its parameters.
+ * Each algorithm only reads the parameters it needs.
+ */
+struct FilterStage {
+
+    // the algorithm of the stage
+    FilterType type;
+
+    // the variant of the algorithm: separable or 2D gaussian blur, exact or grid bilateral filter,
+    // LoG, Sobel, Prewitt or Canny edge detection
+    int algorithm;
+
+    // the size of the kernel for the gaussian blur and the bilateral filter
+    int kernelSize;
+
+    // the standard deviation for the gaussian blur and the bilateral filter
+    float deviation;
+
+    // the range for the bilateral filter
+    float range;
+
+    // the scale factor for the sharpening
+    float scaleFactor;
+
+    // the gradient magnitudes under which Canny finds no edge, and over which it always finds one,
+    // the magnitude of Sobel being divided by 4*sqrt(2) to go from 0 to 1
+    float lowThreshold;
+    float highThreshold;
+
+    FilterStage(FilterType type = GAUSSIAN_BLUR) :
+        type(type),
+        algorithm(0),
+        kernelSize(3),
+        deviation(0.5f),
+        range(0.1f),
+        scaleFactor(0.0f),
+        lowThreshold(0.05f),
+        highThreshold(0.15f) {
+    }
+
+    bool operator==(const FilterStage& other) const {
+        return type == other.type
+                && algorithm == other.algorithm
+                && kernelSize == other.kernelSize
+                && deviation == other.deviation
+                && range == other.range
+                && scaleFactor == other.scaleFactor
+                && lowThreshold == other.lowThreshold
+                && highThreshold == other.highThreshold;
+    }
+
+    bool operator!=(const FilterStage& other) const {
+        return !(*this == other);
+    }
+};
+
+#endif // FILTERSTAGE_H
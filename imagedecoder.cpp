@@ -0,0 +1,272 @@
+#include "imagedecoder.h"
+#include <QDir>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QRunnable>
+
+const int ImageDecoder::DEFAULT_PREFETCH_COUNT;
+
+/**
+ * Decodes one file in the pool and gives the result back to the decoder.
+ */
+class ImageDecoder::DecodeTask : public QRunnable
+{
+private:
+    ImageDecoder* decoder;
+    QString fileName;
+    int generation;
+    QSize scaledSize;
+    QRect clipRect;
+    int maxSize;
+    int previewSize;
+
+public:
+    DecodeTask(ImageDecoder* decoder, const QString& fileName) :
+        decoder(decoder),
+        fileName(fileName),
+        generation(decoder->generation),
+        scaledSize(decoder->scaledSize),
+        clipRect(decoder->clipRect),
+        maxSize(decoder->maxSize),
+        previewSize(decoder->previewSize) {
+    }
+
+    void run() {
+        decoder->finish(fileName, generation, ImageDecoder::decode(fileName, scaledSize, clipRect, maxSize, previewSize));
+    }
+};
+
+/**
+ * Creates the pool of decoding threads, one per core.
+ *
+ * @brief ImageDecoder::ImageDecoder
+ * @param prefetchCount the number of files decoded ahead
+ */
+ImageDecoder::ImageDecoder(int prefetchCount) :
+    prefetchCount(prefetchCount) {
+
+    // the files are decoded at their own size by default
+    maxSize = 0;
+    previewSize = 0;
+    generation = 0;
+}
+
+/**
+ * Waits for the decodings in progress, they give their result to this decoder.
+ *
+ * @brief ImageDecoder::~ImageDecoder
+ */
+ImageDecoder::~ImageDecoder() {
+    pool.waitForDone();
+}
+
+/**
+ * @brief ImageDecoder::getPrefetchCount
+ * @return the number of files decoded ahead
+ */
+int ImageDecoder::getPrefetchCount() const {
+    return prefetchCount;
+}
+
+/**
+ * Decodes the next files at this size, with QImageReader::setScaledSize.
+ * An invalid size keeps the size of the files.
+ *
+ * @brief ImageDecoder::setScaledSize
+ * @param size
+ */
+void ImageDecoder::setScaledSize(const QSize& size) {
+    QMutexLocker locker(&mutex);
+    scaledSize = size;
+    resetCache();
+}
+
+/**
+ * Only decodes this part of the next files, with QImageReader::setClipRect.
+ * An invalid rectangle decodes the whole files.
+ *
+ * @brief ImageDecoder::setClipRect
+ * @param rect
+ */
+void ImageDecoder::setClipRect(const QRect& rect) {
+    QMutexLocker locker(&mutex);
+    clipRect = rect;
+    resetCache();
+}
+
+/**
+ * Decodes the next files bigger than a size at a preview resolution.
+ *
+ * @brief ImageDecoder::setPreviewSize
+ * @param maxSize the biggest width or height decoded as it is, 0 for no limit
+ * @param previewSize the biggest width or height of the previews
+ */
+void ImageDecoder::setPreviewSize(int maxSize, int previewSize) {
+    QMutexLocker locker(&mutex);
+    this->maxSize = maxSize;
+    this->previewSize = previewSize;
+    resetCache();
+}
+
+/**
+ * Drops the images decoded with the previous options.
+ * The mutex has to be locked.
+ *
+ * @brief ImageDecoder::resetCache
+ */
+void ImageDecoder::resetCache() {
+    decodedImages.clear();
+    pendingFiles.clear();
+    generation++;
+}
+
+/**
+ * Starts decoding files that will be needed soon, the first ones first.
+ * Only the first files up to the prefetch count are kept,
+ * the other decoded images are released.
+ *
+ * @brief ImageDecoder::prefetch
+ * @param fileNames
+ */
+void ImageDecoder::prefetch(const QStringList& fileNames) {
+    QMutexLocker locker(&mutex);
+    QStringList wantedFiles = fileNames.mid(0, prefetchCount);
+
+    // releasing the images that are not wanted anymore
+    for(const QString& fileName : decodedImages.keys()) {
+        if(!wantedFiles.contains(fileName)) {
+            decodedImages.remove(fileName);
+        }
+    }
+
+    // decoding the missing ones
+    for(const QString& fileName : wantedFiles) {
+        if(!decodedImages.contains(fileName) && !pendingFiles.contains(fileName)) {
+            start(fileName);
+        }
+    }
+}
+
+/**
+ * Gets a decoded image, waits for it if it is still being decoded.
+ * A file that has not been prefetched is decoded right away.
+ * The image stays in the queue until a prefetch does not want it anymore.
+ *
+ * @brief ImageDecoder::take
+ * @param fileName
+ * @return the decoded image
+ */
+DecodedImage ImageDecoder::take(const QString& fileName) {
+    QMutexLocker locker(&mutex);
+    if(!decodedImages.contains(fileName) && !pendingFiles.contains(fileName)) {
+        start(fileName);
+    }
+    while(!decodedImages.contains(fileName)) {
+        decodedCondition.wait(&mutex);
+    }
+    return decodedImages.value(fileName);
+}
+
+/**
+ * Queues the decoding of a file in the pool.
+ * The mutex has to be locked.
+ *
+ * @brief ImageDecoder::start
+ * @param fileName
+ */
+void ImageDecoder::start(const QString& fileName) {
+    pendingFiles.insert(fileName);
+    pool.start(new DecodeTask(this, fileName));
+}
+
+/**
+ * Keeps the result of a decoding and wakes up the threads waiting for an image.
+ * A result decoded with previous options is dropped.
+ *
+ * @brief ImageDecoder::finish
+ * @param fileName
+ * @param taskGeneration the options the file has been decoded with
+ * @param decoded
+ */
+void ImageDecoder::finish(const QString& fileName, int taskGeneration, const DecodedImage& decoded) {
+    QMutexLocker locker(&mutex);
+    if(taskGeneration != generation) {
+        return;
+    }
+    pendingFiles.remove(fileName);
+    decodedImages.insert(fileName, decoded);
+    decodedCondition.wakeAll();
+}
+
+/**
+ * Decodes a file into QImage::Format_RGBA8888, the byte order opengl reads,
+ * or into QImage::Format_RGBA64 when it has 16 bits per channel.
+ * The conversion is done by the calling thread, the upload does not have to.
+ *
+ * @brief ImageDecoder::decode
+ * @param fileName
+ * @param scaledSize the size to decode at, an invalid size keeps the size of the file
+ * @param clipRect the part of the file to decode, an invalid rectangle decodes the whole file
+ * @param maxSize the biggest width or height decoded as it is when no size is given, 0 for no limit
+ * @param previewSize the biggest width or height of the bigger images
+ * @return the decoded image
+ */
+DecodedImage ImageDecoder::decode(const QString& fileName, const QSize& scaledSize, const QRect& clipRect,
+                                  int maxSize, int previewSize) {
+    DecodedImage decoded;
+    QImageReader reader(fileName);
+    decoded.originalSize = reader.size();
+
+    // the images too big to be loaded at once are decoded at a preview resolution,
+    // which most decoders do much faster than the full one
+    QSize size = scaledSize;
+    QSize clippedSize = clipRect.isValid() ? clipRect.size() : decoded.originalSize;
+    if(!size.isValid() && maxSize > 0 && clippedSize.isValid()
+            && (clippedSize.width() > maxSize || clippedSize.height() > maxSize)) {
+        size = clippedSize.scaled(previewSize, previewSize, Qt::KeepAspectRatio);
+    }
+    if(clipRect.isValid()) {
+        reader.setClipRect(clipRect);
+    }
+    if(size.isValid()) {
+        reader.setScaledSize(size);
+    }
+
+    QImage image;
+    if(!reader.read(&image)) {
+        decoded.error = reader.errorString();
+        return decoded;
+    }
+    if(!decoded.originalSize.isValid()) {
+        decoded.originalSize = image.size();
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    if(image.depth() == 64) {
+        decoded.image = image.convertToFormat(QImage::Format_RGBA64);
+        return decoded;
+    }
+#endif
+    decoded.image = image.convertToFormat(QImage::Format_RGBA8888);
+    return decoded;
+}
+
+/**
+ * Lists the images of a directory.
+ *
+ * @brief ImageDecoder::listImages
+ * @param directoryPath
+ * @return the path of every file with an extension that can be read, by name
+ */
+QStringList ImageDecoder::listImages(const QString& directoryPath) {
+    QStringList nameFilters;
+    for(const QByteArray& format : QImageReader::supportedImageFormats()) {
+        nameFilters << QString("*.%1").arg(QString(format));
+    }
+
+    QStringList files;
+    QDir directory(directoryPath);
+    for(const QString& fileName : directory.entryList(nameFilters, QDir::Files, QDir::Name)) {
+        files << directory.filePath(fileName);
+    }
+    return files;
+}
@@ -0,0 +1,80 @@
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSet>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+/**
+ * An image decoded out of the main thread, ready to be uploaded.
+ */
+struct DecodedImage {
+
+    // the pixels in QImage::Format_RGBA8888, null when the file cannot be read
+    QImage image;
+
+    // the size of the image in the file, before any scaling or clipping
+    QSize originalSize;
+
+    // why the file cannot be read
+    QString error;
+};
+
+/**
+ * Decodes images in a pool of threads, before they are needed.
+ * The next files to show are prefetched into a bounded queue,
+ * so that going from one image to another does not wait for the decoding.
+ */
+class ImageDecoder
+{
+private:
+    class DecodeTask;
+
+    QThreadPool pool;
+    QMutex mutex;
+    QWaitCondition decodedCondition;
+
+    // the decoded images and the ones being decoded, by file name
+    QHash<QString, DecodedImage> decodedImages;
+    QSet<QString> pendingFiles;
+    int prefetchCount;
+
+    // the decoding options, the images decoded with previous options are dropped
+    QSize scaledSize;
+    QRect clipRect;
+    int maxSize;
+    int previewSize;
+    int generation;
+    void resetCache();
+
+    void start(const QString& fileName);
+    void finish(const QString& fileName, int taskGeneration, const DecodedImage& decoded);
+
+public:
+    // the number of files decoded ahead by default
+    static const int DEFAULT_PREFETCH_COUNT = 4;
+
+    explicit ImageDecoder(int prefetchCount = DEFAULT_PREFETCH_COUNT);
+    ~ImageDecoder();
+
+    int getPrefetchCount() const;
+    void setScaledSize(const QSize& size);
+    void setClipRect(const QRect& rect);
+    void setPreviewSize(int maxSize, int previewSize);
+
+    void prefetch(const QStringList& fileNames);
+    DecodedImage take(const QString& fileName);
+
+    static DecodedImage decode(const QString& fileName, const QSize& scaledSize = QSize(), const QRect& clipRect = QRect(),
+                               int maxSize = 0, int previewSize = 0);
+    static QStringList listImages(const QString& directoryPath);
+};
+
+#endif // IMAGEDECODER_H
@@ -0,0 +1,2651 @@
+#include "imageprocessor.h"
+#include <QOpenGLContext>
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+const int ImageProcessor::MAX_KERNEL_SIZE;
+const int ImageProcessor::MAX_SEPARABLE_KERNEL_SIZE;
+const int ImageProcessor::RENDER_TARGET_COUNT;
+const int ImageProcessor::EDGE_ALGORITHM_COUNT;
+const int ImageProcessor::KERNEL_CACHE_SIZE;
+const int ImageProcessor::DEFAULT_TILE_SIZE;
+const int ImageProcessor::ATLAS_SIZE;
+const int ImageProcessor::UPLOAD_BUFFER_COUNT;
+const int ImageProcessor::READBACK_COUNT;
+const int ImageProcessor::COMPUTE_TILE_SIZE;
+const int ImageProcessor::CANNY_ALGORITHM;
+const int ImageProcessor::BOX_ALGORITHM;
+const int ImageProcessor::BOX_GAUSSIAN_ALGORITHM;
+const int ImageProcessor::BOX_GAUSSIAN_PASSES;
+const int ImageProcessor::MAX_BOX_KERNEL_SIZE;
+const int ImageProcessor::SAT_GAMMA_SCALE;
+const int ImageProcessor::SAT_LINEAR_SCALE;
+const int ImageProcessor::SAT_RADIX;
+const int ImageProcessor::CANNY_KERNEL_SIZE;
+const int ImageProcessor::CANNY_HYSTERESIS_PASSES;
+const float ImageProcessor::CANNY_DEVIATION = 1.4f;
+const float ImageProcessor::CANNY_GRADIENT_SCALE = 0.25f / sqrt(2.0f);
+
+const float ImageProcessor::SHARPENING_KERNEL[9] = { 0.0f, -1.0f, 0.0f,
+                                                     -1.0f, 4.0f, -1.0f,
+                                                     0.0f, -1.0f, 0.0f
+                                                   };
+
+/**
+ * The opengl side of the application: the shaders, the quad and the textures.
+ * Nothing is created before initialize is called with a current context.
+ *
+ * @brief ImageProcessor::ImageProcessor
+ */
+ImageProcessor::ImageProcessor() {
+
+    // no image has been loaded yet
+    xOffset = 0.0;
+    yOffset = 0.0;
+    imageWidth = 0;
+    imageHeight = 0;
+    imageTextureID = 0;
+    precision = GAMMA_8BIT;
+    imageDeep = false;
+    linearImage.fboID = 0;
+    linearImage.textureID = 0;
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        renderTargets[i].fboID = 0;
+        renderTargets[i].textureID = 0;
+    }
+    exportTarget.fboID = 0;
+    exportTarget.textureID = 0;
+    exportWidth = 0;
+    exportHeight = 0;
+    exportDeep = false;
+    atlasApron = 0;
+    mipSource.fboID = 0;
+    mipSource.textureID = 0;
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        mipTargets[i].fboID = 0;
+        mipTargets[i].textureID = 0;
+    }
+    mipLevel = 0;
+    mipSourceValid = false;
+    renderWidth = 0;
+    renderHeight = 0;
+    renderLevel = 0;
+    activeTargets = renderTargets;
+
+    // nothing is being transferred yet
+    for(int i = 0; i < UPLOAD_BUFFER_COUNT; i++) {
+        uploadBufferIDs[i] = 0;
+    }
+    nextUploadBuffer = 0;
+    for(int i = 0; i < READBACK_COUNT; i++) {
+        readbacks[i].bufferID = 0;
+        readbacks[i].fence = 0;
+        readbacks[i].width = 0;
+        readbacks[i].height = 0;
+        readbacks[i].deep = false;
+    }
+    firstReadback = 0;
+    pendingReadbackCount = 0;
+
+    // nothing has been rendered yet
+    timingEnabled = false;
+    outputFboID = 0;
+    outputWidth = 0;
+    outputHeight = 0;
+
+    // the kernels that never change are calculated once
+    shKernel = QVector<float>(9);
+    std::copy(SHARPENING_KERNEL, SHARPENING_KERNEL + 9, shKernel.begin());
+    for(int algorithm = 0; algorithm < EDGE_ALGORITHM_COUNT; algorithm++) {
+        edKernels[algorithm] = QVector<float>(9);
+        calculateEdgeKernel(edKernels[algorithm].data(), algorithm);
+    }
+
+    // nothing has been created yet
+    gl33 = NULL;
+    gl43 = NULL;
+    computeEnabled = true;
+    bilateralGrid.fboID = 0;
+    bilateralGrid.textureIDs[0] = bilateralGrid.textureIDs[1] = 0;
+    bilateralGrid.width = bilateralGrid.height = bilateralGrid.depth = 0;
+    for(int i = 0; i < 2; i++) {
+        satTargets[i].fboID = 0;
+        satTargets[i].textureID = 0;
+    }
+    satWidth = 0;
+    satHeight = 0;
+    vao = NULL;
+    screenVao = NULL;
+    vboPosition = NULL;
+    vboTexture = NULL;
+    vboScreenTexture = NULL;
+}
+
+/**
+ * Releases all the opengl objects.
+ * The context they have been created in has to be current.
+ *
+ * @brief ImageProcessor::~ImageProcessor
+ */
+ImageProcessor::~ImageProcessor() {
+    if(vao == NULL) {
+        return;
+    }
+
+    // releasing the textures and the frame buffer objects
+    if(imageTextureID != 0) {
+        glDeleteTextures(1, &imageTextureID);
+    }
+    releaseRenderTarget(linearImage);
+    releaseRenderTargets();
+    releaseMipTargets();
+    releaseRenderTarget(exportTarget);
+    releaseBilateralGrid();
+    releaseSummedAreaTable();
+
+    // releasing the timer queries
+    passTimer.release();
+
+    // releasing the pixel buffer objects and the fences of the transfers
+    if(gl33 != NULL) {
+        glDeleteBuffers(UPLOAD_BUFFER_COUNT, uploadBufferIDs);
+        for(int i = 0; i < READBACK_COUNT; i++) {
+            glDeleteBuffers(1, &readbacks[i].bufferID);
+            if(readbacks[i].fence != 0) {
+                gl33->glDeleteSync(readbacks[i].fence);
+            }
+        }
+    }
+
+    // releasing the quad
+    delete vao;
+    delete screenVao;
+    delete vboPosition;
+    delete vboTexture;
+    delete vboScreenTexture;
+
+    // releasing the shaders
+    for(const ShaderVariant& variant : shaderVariants) {
+        delete variant.program;
+    }
+    releaseComputeVariants();
+    delete shaderProgram;
+    delete srgbDecodeProgram;
+    delete srgbEncodeProgram;
+    delete gbShaderProgram;
+    delete gbsShaderProgram;
+    delete bfShaderProgram;
+    delete shShaderProgram;
+    delete edShaderProgram;
+    delete egShaderProgram;
+    delete cnSuppressionShaderProgram;
+    delete cnThresholdShaderProgram;
+    delete cnHysteresisShaderProgram;
+    delete bgSplatShaderProgram;
+    delete bgBlurShaderProgram;
+    delete bgSliceShaderProgram;
+    delete satScanShaderProgram;
+    delete satBoxShaderProgram;
+    delete atlasApronShaderProgram;
+    delete vertexShader;
+}
+
+/**
+ * Initializes opengl functions in the current context.
+ * Creates the 3D object quad to display a texture.
+ * Creates and links all the shaders that will be used in the application.
+ *
+ * @brief ImageProcessor::initialize
+ */
+void ImageProcessor::initialize() {
+    initializeOpenGLFunctions();
+
+    // the bilateral grid needs 3D textures and the asynchronous transfers need mapped buffers and fences,
+    // without them the exact bilateral filter is used and the transfers are synchronous
+    gl33 = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if(gl33 == NULL || !gl33->initializeOpenGLFunctions()) {
+        qWarning("OpenGL 3.3 functions are not available, the bilateral grid and the pixel buffer objects are disabled");
+        gl33 = NULL;
+    }
+
+    // the compute shaders are part of opengl 4.3, without them every pass is a fragment shader
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context->format().version() >= qMakePair(4, 3)) {
+        gl43 = context->versionFunctions<QOpenGLFunctions_4_3_Core>();
+        if(gl43 != NULL && !gl43->initializeOpenGLFunctions()) {
+            gl43 = NULL;
+        }
+    }
+
+    // the timer queries are part of opengl 3.3 too
+    passTimer.initialize(gl33);
+
+    // creating the pixel buffer objects, they are allocated along with the transfers
+    if(gl33 != NULL) {
+        glGenBuffers(UPLOAD_BUFFER_COUNT, uploadBufferIDs);
+        for(int i = 0; i < READBACK_COUNT; i++) {
+            glGenBuffers(1, &readbacks[i].bufferID);
+        }
+    }
+
+    // creating 3D object to draw onto
+    createQuad();
+
+    // creating shaders
+    createShaders();
+}
+
+/**
+ * Loads the image into the gpu as a texture.
+ * Creates the pool of targets of its size, the ones of the previous image are released.
+ * When the previous image has the same size, its texture and its targets are reused.
+ *
+ * @brief ImageProcessor::loadImage
+ * @param image
+ */
+void ImageProcessor::loadImage(const QImage& image) {
+
+    // rgba and argb pixels are uploaded as they are, the texture's rows go from top to bottom like theirs
+    // argb pixels are 32 bits integers, which opengl reads as bgra whatever the byte order
+    // the images with 16 bits per channel are uploaded as 16 bits integers
+    bool deep = isDeepImage(image);
+    QImage glImage = image;
+    GLenum format = GL_RGBA;
+    GLenum type = GL_UNSIGNED_BYTE;
+    if(deep) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        if(image.format() != QImage::Format_RGBA64) {
+            glImage = image.convertToFormat(QImage::Format_RGBA64);
+        }
+#endif
+        type = GL_UNSIGNED_SHORT;
+    } else if(image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32) {
+        format = GL_BGRA;
+        type = GL_UNSIGNED_INT_8_8_8_8_REV;
+    } else if(image.format() != QImage::Format_RGBA8888 && image.format() != QImage::Format_RGBX8888) {
+        glImage = image.convertToFormat(QImage::Format_RGBA8888);
+    }
+
+    // only creating the gpu objects when the size or the depth changes
+    if(imageTextureID == 0 || glImage.width() != imageWidth || glImage.height() != imageHeight || deep != imageDeep) {
+        imageWidth = glImage.width();
+        imageHeight = glImage.height();
+        imageDeep = deep;
+
+        // going up in the image is going back in the texture's rows
+        xOffset = 1.0 / glImage.width();
+        yOffset = -1.0 / glImage.height();
+
+        // releasing the gpu objects of the previous image
+        if(imageTextureID != 0) {
+            glDeleteTextures(1, &imageTextureID);
+        }
+        releaseRenderTarget(linearImage);
+        releaseRenderTargets();
+        releaseMipTargets();
+        releaseBilateralGrid();
+        releaseSummedAreaTable();
+
+        // creating the texture
+        glGenTextures(1, &imageTextureID);
+
+        // binding the texture
+        glBindTexture(GL_TEXTURE_2D, imageTextureID);
+
+        // allocating the gpu texture and parameterizing it, in linear precision the sampler decodes the 8 bits from srgb
+        GLenum internalFormat = deep ? GL_RGBA16 : (precision == LINEAR_FLOAT16 ? GL_SRGB8_ALPHA8 : GL_RGBA);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, imageWidth, imageHeight, 0, GL_RGBA, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // unbinding texture
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // the multi-passes algorithms need intermediate targets of the image's size
+        createRenderTargets();
+        if(deep && precision == LINEAR_FLOAT16) {
+            createRenderTarget(linearImage, imageWidth, imageHeight, GL_RGBA16F);
+        }
+    }
+
+    // loading the buffer into the gpu texture, the mip level has to be downsampled again
+    uploadPixels(glImage.constBits(), glImage.byteCount(), format, type);
+    mipSourceValid = false;
+
+    // decoding the 16 bits from srgb once, every render reads the linear copy
+    if(linearImage.fboID != 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, linearImage.fboID);
+        glViewport(0, 0, imageWidth, imageHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, imageTextureID);
+        srgbDecodeProgram->bind();
+        drawQuad();
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+}
+
+/**
+ * Gets the texture the first pass reads: the image's one, or its copy decoded to linear light.
+ *
+ * @brief ImageProcessor::getImageSourceTextureID
+ * @return the texture
+ */
+GLuint ImageProcessor::getImageSourceTextureID() const {
+    return linearImage.fboID != 0 ? linearImage.textureID : imageTextureID;
+}
+
+/**
+ * @brief ImageProcessor::getTargetFormat
+ * @return the internal format of the intermediate targets in the current precision
+ */
+GLenum ImageProcessor::getTargetFormat() const {
+    return precision == LINEAR_FLOAT16 ? GL_RGBA16F : GL_RGBA8;
+}
+
+/**
+ * @brief ImageProcessor::getTargetBytesPerPixel
+ * @return the size of a pixel of the intermediate targets in the current precision
+ */
+int ImageProcessor::getTargetBytesPerPixel() const {
+    return precision == LINEAR_FLOAT16 ? 8 : 4;
+}
+
+/**
+ * Chooses the precision of the next images.
+ * The gpu objects of the current image are released, the image has to be loaded again,
+ * and the compute programs, which are compiled for the format of the targets.
+ *
+ * @brief ImageProcessor::setPrecision
+ * @param precision
+ */
+void ImageProcessor::setPrecision(Precision precision) {
+    if(precision == this->precision) {
+        return;
+    }
+    this->precision = precision;
+    if(imageTextureID != 0) {
+        glDeleteTextures(1, &imageTextureID);
+        imageTextureID = 0;
+    }
+    releaseRenderTarget(linearImage);
+    releaseRenderTargets();
+    releaseMipTargets();
+    releaseRenderTarget(exportTarget);
+    releaseBilateralGrid();
+    releaseComputeVariants();
+}
+
+/**
+ * @brief ImageProcessor::getPrecision
+ * @return the precision of the processing
+ */
+ImageProcessor::Precision ImageProcessor::getPrecision() const {
+    return precision;
+}
+
+/**
+ * @brief ImageProcessor::precisionName
+ * @param precision
+ * @return the name of the precision, as given on the command line
+ */
+QString ImageProcessor::precisionName(Precision precision) {
+    return precision == LINEAR_FLOAT16 ? QString("linear16f") : QString("gamma8");
+}
+
+/**
+ * Tells whether an image has 16 bits per channel, which QImage only has since Qt 5.12.
+ *
+ * @brief ImageProcessor::isDeepImage
+ * @param image
+ * @return true if its pixels take 64 bits
+ */
+bool ImageProcessor::isDeepImage(const QImage& image) {
+    return image.depth() == 64;
+}
+
+/**
+ * Copies the pixels into the image's texture.
+ * The cpu copies them into the next pixel buffer object, then the gpu fills the texture from it
+ * without the cpu waiting for the transfer. The copy itself, and the conversion loadImage may do before it,
+ * are synchronous: only the decoding of the next images runs meanwhile, in the threads of the decoder.
+ *
+ * @brief ImageProcessor::uploadPixels
+ * @param pixels the pixels, from top to bottom
+ * @param size the number of bytes
+ * @param format the order of the channels
+ * @param type the type of the pixels
+ */
+void ImageProcessor::uploadPixels(const uchar* pixels, int size, GLenum format, GLenum type) {
+    glBindTexture(GL_TEXTURE_2D, imageTextureID);
+
+    // without pixel buffer objects, the texture is filled right away
+    void* buffer = NULL;
+    if(gl33 != NULL) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBufferIDs[nextUploadBuffer]);
+        nextUploadBuffer = (nextUploadBuffer + 1) % UPLOAD_BUFFER_COUNT;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        buffer = gl33->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    if(buffer != NULL) {
+
+        // the texture reads the pixel buffer object, from its start
+        memcpy(buffer, pixels, size);
+        gl33->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, imageWidth, imageHeight, format, type, NULL);
+    } else {
+        if(gl33 != NULL) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, imageWidth, imageHeight, format, type, pixels);
+    }
+
+    // unbinding the buffer and the texture
+    if(gl33 != NULL) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/**
+ * @brief ImageProcessor::getImageWidth
+ * @return the width of the loaded image
+ */
+int ImageProcessor::getImageWidth() const {
+    return imageWidth;
+}
+
+/**
+ * @brief ImageProcessor::getImageHeight
+ * @return the height of the loaded image
+ */
+int ImageProcessor::getImageHeight() const {
+    return imageHeight;
+}
+
+/**
+ * Gets the biggest image that can be loaded at once, in width and in height.
+ * Bigger images have to be processed in tiles.
+ *
+ * @brief ImageProcessor::getMaxTextureSize
+ * @return the size in pixels
+ */
+int ImageProcessor::getMaxTextureSize() {
+    GLint maxTextureSize = 0;
+    GLint maxViewportSize[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportSize);
+    return qMin(maxTextureSize, qMin(maxViewportSize[0], maxViewportSize[1]));
+}
+
+/**
+ * Gets the memory taken by the textures currently allocated:
+ * the image and its linear copy, the targets of its size, the export target and the bilateral grid.
+ * The intermediate targets take twice as much in linear precision.
+ *
+ * @brief ImageProcessor::getTextureMemory
+ * @return the size in bytes
+ */
+qint64 ImageProcessor::getTextureMemory() const {
+    qint64 pixelCount = (qint64)imageWidth * imageHeight;
+    qint64 imageSize = (imageDeep ? 8 : 4) * pixelCount;
+    qint64 targetSize = getTargetBytesPerPixel() * pixelCount;
+    qint64 bytes = 0;
+    if(imageTextureID != 0) {
+        bytes += imageSize;
+    }
+    if(linearImage.textureID != 0) {
+        bytes += 8 * pixelCount;
+    }
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        if(renderTargets[i].textureID != 0) {
+            bytes += targetSize;
+        }
+    }
+    if(exportTarget.textureID != 0) {
+        bytes += (exportDeep ? 8LL : 4LL) * exportWidth * exportHeight;
+    }
+
+    // the mipmaps of the image take a third of its size, the mip level's source and targets a quarter per level
+    if(mipLevel > 0) {
+        qint64 mipSize = (qint64)getTargetBytesPerPixel() * qMax(1, imageWidth >> mipLevel) * qMax(1, imageHeight >> mipLevel);
+        bytes += (linearImage.textureID != 0 ? 8 * pixelCount : imageSize) / 3 + (1 + RENDER_TARGET_COUNT) * mipSize;
+    }
+
+    // the grid's cells are four half floats, the summed-area tables' texels four 32 bits integers
+    if(bilateralGrid.fboID != 0) {
+        bytes += 2 * 8LL * bilateralGrid.width * bilateralGrid.height * bilateralGrid.depth;
+    }
+    if(satTargets[0].fboID != 0) {
+        bytes += 2 * 16LL * satWidth * satHeight;
+    }
+    return bytes;
+}
+
+/**
+ * Estimates the bytes moved by a render of the loaded image read back at its size:
+ * the upload, every pass reading and writing each pixel once, and the readback.
+ * The taps of the kernels are not counted, they mostly hit the texture cache.
+ *
+ * @brief ImageProcessor::getFrameTraffic
+ * @param pipeline
+ * @return the size in bytes
+ */
+qint64 ImageProcessor::getFrameTraffic(const QList<FilterStage>& pipeline) const {
+    qint64 pixelCount = (qint64)imageWidth * imageHeight;
+    int imageBytes = imageDeep ? 8 : 4;
+
+    // the linear precision decodes the 16 bits images once, and encodes the result back to srgb
+    // the box blurs also build a summed-area table, each of its passes reads and writes 16 bytes per pixel
+    int passes = 0;
+    qint64 bytes = imageBytes * pixelCount;
+    for(const FilterStage& stage : pipeline) {
+        passes += passCount(stage);
+        if(stage.type == GAUSSIAN_BLUR && stage.algorithm >= BOX_ALGORITHM) {
+            bytes += passCount(stage) * satScanPassCount(imageWidth, imageHeight) * 2 * 16LL * pixelCount;
+        }
+    }
+    if(precision == LINEAR_FLOAT16) {
+        passes++;
+        if(imageDeep) {
+            bytes += (imageBytes + 8) * pixelCount;
+        }
+    }
+    bytes += passes * 2LL * getTargetBytesPerPixel() * pixelCount;
+    return bytes + imageBytes * pixelCount;
+}
+
+/**
+ * Enables or disables the measure of the passes by the gpu.
+ *
+ * @brief ImageProcessor::setTimingEnabled
+ * @param enabled
+ */
+void ImageProcessor::setTimingEnabled(bool enabled) {
+    timingEnabled = enabled;
+}
+
+/**
+ * @brief ImageProcessor::isTimingEnabled
+ * @return whether the passes are measured
+ */
+bool ImageProcessor::isTimingEnabled() const {
+    return timingEnabled;
+}
+
+/**
+ * Gets the timings of the passes of the last renders.
+ *
+ * @brief ImageProcessor::getPassTimer
+ * @return the timer
+ */
+PassTimer& ImageProcessor::getPassTimer() {
+    return passTimer;
+}
+
+/**
+ * @brief ImageProcessor::getProgramCache
+ * @return the cache the programs have been created with
+ */
+const ProgramCache& ImageProcessor::getProgramCache() const {
+    return programCache;
+}
+
+/**
+ * Creates all the shaders for all the algorithms.
+ * Compiles the vertex shader once, and links each program with it,
+ * unless the program cache has its binary from a previous start.
+ *
+ * @brief ImageProcessor::createShaders
+ */
+void ImageProcessor::createShaders() {
+
+    // the vertex shader, compiled once for every program
+    QFile vertexFile(":/shaders/vertex_shader.vsh");
+    vertexFile.open(QIODevice::ReadOnly);
+    vertexSource = vertexFile.readAll();
+    vertexShader = new QOpenGLShader(QOpenGLShader::Vertex);
+    vertexShader->compileSourceCode(vertexSource);
+
+    // the linked programs are kept on disk for the next starts
+    programCache.initialize();
+
+    // creating the shader for the original image
+    shaderProgram = createProgram(":/shaders/original.fsh");
+
+    // creating the shaders converting between srgb and linear values, for the linear precision
+    srgbDecodeProgram = createProgram(":/shaders/original.fsh", "#define DECODE_SRGB\n");
+    srgbEncodeProgram = createProgram(":/shaders/original.fsh", "#define ENCODE_SRGB\n");
+
+    // creating the shader for gaussian blur algorithm
+    gbShaderProgram = createProgram(":/shaders/gaussian_blur.fsh");
+    resolveUniforms(gbShaderProgram, gbUniforms);
+
+    // creating the shader for the separable gaussian blur algorithm
+    gbsShaderProgram = createProgram(":/shaders/gaussian_blur_separable.fsh");
+    resolveUniforms(gbsShaderProgram, gbsUniforms);
+
+    // creating the shader for bilateral filter algorithm
+    bfShaderProgram = createProgram(":/shaders/bilateral_filter.fsh");
+    resolveUniforms(bfShaderProgram, bfUniforms);
+
+    // creating the shader for the sharpening algorithm
+    shShaderProgram = createProgram(":/shaders/sharpening.fsh");
+    resolveUniforms(shShaderProgram, shUniforms);
+
+    // creating the shader for edge detection algorithm
+    edShaderProgram = createProgram(":/shaders/edge_detection.fsh");
+    resolveUniforms(edShaderProgram, edUniforms);
+
+    // creating the shader for the gradient of Sobel and Prewitt
+    egShaderProgram = createProgram(":/shaders/edge_gradient.fsh");
+    resolveUniforms(egShaderProgram, egUniforms);
+
+    // creating the shaders thinning the gradient, sorting the edges and growing the strong ones for Canny
+    cnSuppressionShaderProgram = createProgram(":/shaders/canny_suppression.fsh");
+    resolveUniforms(cnSuppressionShaderProgram, cnSuppressionUniforms);
+    cnThresholdShaderProgram = createProgram(":/shaders/canny_threshold.fsh");
+    resolveUniforms(cnThresholdShaderProgram, cnThresholdUniforms);
+    cnHysteresisShaderProgram = createProgram(":/shaders/canny_hysteresis.fsh");
+    resolveUniforms(cnHysteresisShaderProgram, cnHysteresisUniforms);
+
+    // creating the shaders splatting the image into the bilateral grid, blurring it and slicing it
+    bgSplatShaderProgram = createProgram(":/shaders/bilateral_grid_splat.fsh");
+    resolveUniforms(bgSplatShaderProgram, bgSplatUniforms);
+    bgBlurShaderProgram = createProgram(":/shaders/bilateral_grid_blur.fsh");
+    resolveUniforms(bgBlurShaderProgram, bgBlurUniforms);
+    bgSliceShaderProgram = createProgram(":/shaders/bilateral_grid_slice.fsh");
+    resolveUniforms(bgSliceShaderProgram, bgSliceUniforms);
+
+    // the grid is read on the second texture unit, next to the image
+    bgSliceShaderProgram->bind();
+    bgSliceShaderProgram->setUniformValue("grid_texture", 1);
+    bgSliceShaderProgram->release();
+
+    // creating the shaders building the summed-area table and reading the boxes from it, on the second unit too
+    satScanShaderProgram = createProgram(":/shaders/sat_scan.fsh");
+    resolveUniforms(satScanShaderProgram, satScanUniforms);
+    satBoxShaderProgram = createProgram(":/shaders/sat_box.fsh");
+    resolveUniforms(satBoxShaderProgram, satBoxUniforms);
+    satScanShaderProgram->bind();
+    satScanShaderProgram->setUniformValue("sum_texture", 1);
+    satBoxShaderProgram->bind();
+    satBoxShaderProgram->setUniformValue("sum_texture", 1);
+    satBoxShaderProgram->release();
+
+    // creating the shader replicating the aprons of an atlas' cells
+    atlasApronShaderProgram = createProgram(":/shaders/atlas_apron.fsh");
+    resolveUniforms(atlasApronShaderProgram, atlasApronUniforms);
+}
+
+/**
+ * Creates a program with the shared vertex shader and a fragment shader of the resources.
+ * The defines are inserted right after the #version line, which has to stay the first one.
+ *
+ * @brief ImageProcessor::createProgram
+ * @param fragmentFile
+ * @param defines such as "#define KERNEL_SIZE 5\n"
+ * @return the program
+ */
+QOpenGLShaderProgram* ImageProcessor::createProgram(const QString& fragmentFile, const QByteArray& defines) {
+    QFile file(fragmentFile);
+    file.open(QIODevice::ReadOnly);
+    QByteArray fragmentSource = file.readAll();
+    fragmentSource.insert(fragmentSource.indexOf('\n') + 1, defines);
+    return programCache.createProgram(vertexShader, vertexSource, fragmentSource);
+}
+
+/**
+ * Creates the 3D object that will host the texture.
+ * Whether it is a plain image or a processed one.
+ *
+ * @brief ImageProcessor::createQuad
+ */
+void ImageProcessor::createQuad() {
+
+    // vertices' position array of coords
+    float position[] = {1.0f, -1.0f, 0.0f,
+                        1.0f, 1.0f, 0.0f,
+                        -1.0f, 1.0f, 0.0f,
+                        -1.0f, 1.0f, 0.0f,
+                        -1.0f, -1.0f, 0.0f,
+                        1.0f, -1.0f, 0.0f
+                       };
+
+    // vertices' texture array of coords
+    float texture[] = {1.0f, 0.0f,
+                       1.0f, 1.0f,
+                       0.0f, 1.0f,
+                       0.0f, 1.0f,
+                       0.0f, 0.0f,
+                       1.0f, 0.0f
+                      };
+
+    // creating vertex array object
+    vao = new QOpenGLVertexArrayObject;
+    vao->create();
+    vao->bind();
+
+    // creating the position vertex buffer object
+    vboPosition = new QOpenGLBuffer;
+    vboPosition->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vboPosition->create();
+    vboPosition->bind();
+    vboPosition->allocate(position, 6*3*sizeof(float));
+
+    // giving the position vbo the index 0
+    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, 0);
+
+    // creating the position vertex buffer object
+    vboTexture = new QOpenGLBuffer;
+    vboTexture->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vboTexture->create();
+    vboTexture->bind();
+    vboTexture->allocate(texture, 6*2*sizeof(float));
+
+    // giving the texture vbo the index 1
+    glVertexAttribPointer(1, 2, GL_FLOAT, false, 0, 0);
+
+    // releasing the objects
+    vao->release();
+    vboTexture->release();
+
+    // the screen's quad shares the positions, its texture coords are upside down
+    float screenTexture[] = {1.0f, 1.0f,
+                             1.0f, 0.0f,
+                             0.0f, 0.0f,
+                             0.0f, 0.0f,
+                             0.0f, 1.0f,
+                             1.0f, 1.0f
+                            };
+
+    // creating the screen's vertex array object
+    screenVao = new QOpenGLVertexArrayObject;
+    screenVao->create();
+    screenVao->bind();
+
+    // giving the position vbo the index 0
+    vboPosition->bind();
+    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, 0);
+
+    // creating the flipped texture vertex buffer object
+    vboScreenTexture = new QOpenGLBuffer;
+    vboScreenTexture->setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vboScreenTexture->create();
+    vboScreenTexture->bind();
+    vboScreenTexture->allocate(screenTexture, 6*2*sizeof(float));
+
+    // giving the flipped texture vbo the index 1
+    glVertexAttribPointer(1, 2, GL_FLOAT, false, 0, 0);
+
+    // releasing the objects
+    screenVao->release();
+    vboPosition->release();
+    vboScreenTexture->release();
+}
+
+/**
+ * Creates the pool of frame buffer objects used between the passes of the algorithms.
+ * Their textures have the size of the loaded image.
+ * They are created once per image and reused by every frame.
+ *
+ * @brief ImageProcessor::createRenderTargets
+ */
+void ImageProcessor::createRenderTargets() {
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        createRenderTarget(renderTargets[i], imageWidth, imageHeight, getTargetFormat());
+    }
+}
+
+/**
+ * Releases the pool of frame buffer objects and their textures.
+ *
+ * @brief ImageProcessor::releaseRenderTargets
+ */
+void ImageProcessor::releaseRenderTargets() {
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        releaseRenderTarget(renderTargets[i]);
+    }
+}
+
+/**
+ * Creates a frame buffer object and the texture it renders into.
+ *
+ * @brief ImageProcessor::createRenderTarget
+ * @param target
+ * @param width
+ * @param height
+ */
+void ImageProcessor::createRenderTarget(RenderTarget& target, int width, int height, GLenum internalFormat) {
+
+    // creating the texture that will receive a pass, the integer ones cannot be filtered
+    bool integer = internalFormat == GL_RGBA32UI;
+    glGenTextures(1, &target.textureID);
+    glBindTexture(GL_TEXTURE_2D, target.textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0,
+                 integer ? GL_RGBA_INTEGER : GL_RGBA, integer ? GL_UNSIGNED_INT : GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, integer ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, integer ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // creating the frame buffer object and attaching the texture to it
+    glGenFramebuffers(1, &target.fboID);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.fboID);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.textureID, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * Releases a frame buffer object and its texture, if they have been created.
+ *
+ * @brief ImageProcessor::releaseRenderTarget
+ * @param target
+ */
+void ImageProcessor::releaseRenderTarget(RenderTarget& target) {
+    if(target.fboID != 0) {
+        glDeleteFramebuffers(1, &target.fboID);
+        glDeleteTextures(1, &target.textureID);
+        target.fboID = 0;
+        target.textureID = 0;
+    }
+}
+
+/**
+ * Creates the source and the targets of a mip level, and downsamples the image into the source if it changed.
+ * The mipmaps of the image average all its pixels, where plain linear sampling would skip most of them.
+ *
+ * @brief ImageProcessor::prepareMipLevel
+ * @param level the number of times the image's size is halved
+ */
+void ImageProcessor::prepareMipLevel(int level) {
+    int width = qMax(1, imageWidth >> level);
+    int height = qMax(1, imageHeight >> level);
+
+    // only creating the targets when the level changes
+    if(level != mipLevel) {
+        releaseMipTargets();
+        createRenderTarget(mipSource, width, height, getTargetFormat());
+        for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+            createRenderTarget(mipTargets[i], width, height, getTargetFormat());
+        }
+        mipLevel = level;
+    }
+    if(mipSourceValid) {
+        return;
+    }
+
+    // the mipmaps are only sampled here, the other passes keep reading the first level
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, getImageSourceTextureID());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, mipSource.fboID);
+    glViewport(0, 0, width, height);
+    shaderProgram->bind();
+    drawQuad();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mipSourceValid = true;
+}
+
+/**
+ * Releases the source and the targets of the mip level.
+ *
+ * @brief ImageProcessor::releaseMipTargets
+ */
+void ImageProcessor::releaseMipTargets() {
+    releaseRenderTarget(mipSource);
+    for(int i = 0; i < RENDER_TARGET_COUNT; i++) {
+        releaseRenderTarget(mipTargets[i]);
+    }
+    mipLevel = 0;
+    mipSourceValid = false;
+}
+
+/**
+ * Gets the smallest mip level of an image which is not bigger than a size.
+ *
+ * @brief ImageProcessor::mipLevelFor
+ * @param width
+ * @param height
+ * @param maxSize
+ * @return the number of times the image's size has to be halved
+ */
+int ImageProcessor::mipLevelFor(int width, int height, int maxSize) {
+    int level = 0;
+    while((qMax(width, height) >> level) > maxSize) {
+        level++;
+    }
+    return level;
+}
+
+/**
+ * Renders the next passes into one of the pooled targets, at the size of the current render.
+ *
+ * @brief ImageProcessor::bindRenderTarget
+ * @param index
+ */
+void ImageProcessor::bindRenderTarget(int index) {
+    glBindFramebuffer(GL_FRAMEBUFFER, activeTargets[index].fboID);
+    glViewport(0, 0, renderWidth, renderHeight);
+}
+
+/**
+ * Renders the next passes into the output of the current render, at the output's size.
+ *
+ * @brief ImageProcessor::bindOutput
+ */
+void ImageProcessor::bindOutput() {
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFboID);
+    glViewport(0, 0, outputWidth, outputHeight);
+}
+
+/**
+ * Draws the quad with the currently bound texture and shader program.
+ *
+ * @brief ImageProcessor::drawQuad
+ * @param onScreen whether the quad is drawn onto the default frame buffer, whose rows are upside down
+ */
+void ImageProcessor::drawQuad(bool onScreen) {
+    QOpenGLVertexArrayObject* quad = onScreen ? screenVao : vao;
+
+    // enabling the vao
+    quad->bind();
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // drawing the quad and disposing the vao
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+
+    // releasing the vao
+    quad->release();
+}
+
+/**
+ * Runs every stage of the pipeline back-to-back.
+ * Each pass reads the result of the previous one and renders into the other pooled target,
+ * the very last pass renders into the output frame buffer object.
+ * When the pipeline is empty, the original image is drawn.
+ * When the timing is enabled, each pass is measured by the gpu.
+ * At a mip level, the passes run on the image downsampled that many times; the offsets between the
+ * samples stay those of the image's pixels, so that the kernels cover the same part of the image.
+ * In linear precision, the passes run on linear values in half floats, and a last pass encodes them back to srgb.
+ *
+ * @brief ImageProcessor::render
+ * @param pipeline
+ * @param fboID the output frame buffer object, 0 for the default one
+ * @param width the output's width
+ * @param height the output's height
+ * @param level the mip level the passes run on, 0 for the image's size
+ */
+void ImageProcessor::render(const QList<FilterStage>& pipeline, GLuint fboID, int width, int height, int level) {
+
+    // remembering where the last pass goes
+    outputFboID = fboID;
+    outputWidth = width;
+    outputHeight = height;
+
+    // counting the passes to know which one draws onto the screen
+    int totalPasses = 0;
+    for(const FilterStage& stage : pipeline) {
+        totalPasses += passCount(stage);
+    }
+    bool linear = precision == LINEAR_FLOAT16;
+
+    // the export target has the format of the pooled targets in 8 bits, the last compute pass can write into it
+    GLuint outputTextureID = 0;
+    if(fboID != 0 && fboID == exportTarget.fboID && !exportDeep && !linear && level == 0) {
+        outputTextureID = exportTarget.textureID;
+    }
+
+    // the first pass reads the image's texture, or its downsampled copy
+    GLuint sourceTextureID = getImageSourceTextureID();
+    renderWidth = imageWidth;
+    renderHeight = imageHeight;
+    renderLevel = 0;
+    activeTargets = renderTargets;
+    if(level > 0 && totalPasses > 0) {
+        prepareMipLevel(level);
+        sourceTextureID = mipSource.textureID;
+        renderWidth = qMax(1, imageWidth >> level);
+        renderHeight = qMax(1, imageHeight >> level);
+        renderLevel = level;
+        activeTargets = mipTargets;
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    // every pass computes as many pixels as the level has
+    if(timingEnabled) {
+        passTimer.beginFrame((qint64)renderWidth * renderHeight);
+    }
+
+    // original image
+    if(totalPasses == 0) {
+        if(timingEnabled) {
+            passTimer.beginPass("Original");
+        }
+        bindOutput();
+        glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+        if(linear) {
+            srgbEncodeProgram->bind();
+        } else {
+            shaderProgram->bind();
+        }
+        drawQuad(outputFboID == 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if(timingEnabled) {
+            passTimer.endPass();
+            passTimer.endFrame();
+        }
+        return;
+    }
+
+    int target = 0;
+    int passIndex = 0;
+    for(const FilterStage& stage : pipeline) {
+        for(int pass = 0; pass < passCount(stage); pass++) {
+            passIndex++;
+
+            // in an atlas, the aprons the pass reads are replicated again from the previous result
+            if(atlasCellSize.isValid() && passIndex > 1 && readsAprons(stage, pass)) {
+                if(timingEnabled) {
+                    passTimer.beginPass("Atlas aprons");
+                }
+                replicateAprons(sourceTextureID, target);
+                if(timingEnabled) {
+                    passTimer.endPass();
+                }
+                sourceTextureID = activeTargets[target].textureID;
+                target = (target + 1) % RENDER_TARGET_COUNT;
+            }
+
+            if(timingEnabled) {
+                passTimer.beginPass(passName(stage, pass));
+            }
+
+            // the compute shaders write into the next pooled target, or into the output's texture for the last pass;
+            // the default frame buffer has no texture, the last pass is drawn into it from the pooled target
+            bool last = passIndex == totalPasses && !linear;
+            ShaderVariant* computeVariant = getComputeStage(stage);
+            if(computeVariant != NULL) {
+                GLuint computeTextureID = (last && outputTextureID != 0) ? outputTextureID : activeTargets[target].textureID;
+                dispatchStage(stage, computeVariant, sourceTextureID, computeTextureID);
+                if(last && outputTextureID == 0) {
+                    bindOutput();
+                    glBindTexture(GL_TEXTURE_2D, activeTargets[target].textureID);
+                    shaderProgram->bind();
+                    drawQuad(outputFboID == 0);
+                }
+            } else {
+
+                // choosing the shader first, some stages render intermediate data of their own
+                computeStage(stage, pass, sourceTextureID);
+
+                // the last pass goes into the output, the others into the next pooled target
+                if(last) {
+                    bindOutput();
+                } else {
+                    bindRenderTarget(target);
+                }
+
+                // reading the previous result
+                glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+                drawQuad(last && outputFboID == 0);
+            }
+            if(timingEnabled) {
+                passTimer.endPass();
+            }
+
+            // the next pass reads what has just been rendered
+            sourceTextureID = activeTargets[target].textureID;
+            target = (target + 1) % RENDER_TARGET_COUNT;
+        }
+    }
+
+    // the linear values are encoded back to srgb into the output
+    if(linear) {
+        if(timingEnabled) {
+            passTimer.beginPass("sRGB encode");
+        }
+        bindOutput();
+        glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+        srgbEncodeProgram->bind();
+        drawQuad(outputFboID == 0);
+        if(timingEnabled) {
+            passTimer.endPass();
+        }
+    }
+
+    // unbinding the texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if(timingEnabled) {
+        passTimer.endFrame();
+    }
+}
+
+/**
+ * Gets the number of passes needed by a stage.
+ * The separable gaussian blur goes through x then y, its approximation by boxes through each box,
+ * Canny goes through its smoothing, gradient, suppression, threshold and hysteresis.
+ *
+ * @brief ImageProcessor::passCount
+ * @param stage
+ * @return the number of passes
+ */
+int ImageProcessor::passCount(const FilterStage& stage) {
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        if(stage.algorithm == BOX_GAUSSIAN_ALGORITHM) {
+            return BOX_GAUSSIAN_PASSES;
+        }
+        return stage.algorithm == 0 ? 2 : 1;
+    case EDGE_DETECTION:
+        return stage.algorithm == CANNY_ALGORITHM ? 5 + CANNY_HYSTERESIS_PASSES : 1;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Gets the name of a pass of a stage, as shown with its timing.
+ *
+ * @brief ImageProcessor::passName
+ * @param stage
+ * @param pass
+ * @return the name
+ */
+QString ImageProcessor::passName(const FilterStage& stage, int pass) {
+    static const char* edgeNames[EDGE_ALGORITHM_COUNT] = { "LoG", "Sobel", "Prewitt" };
+    static const char* cannyNames[5] = { "Canny blur x", "Canny blur y", "Canny gradient", "Canny suppression", "Canny threshold" };
+
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        if(stage.algorithm == 0) {
+            return pass == 0 ? QString("Gaussian blur x") : QString("Gaussian blur y");
+        } else if(stage.algorithm == BOX_ALGORITHM) {
+            return QString("Box blur");
+        } else if(stage.algorithm == BOX_GAUSSIAN_ALGORITHM) {
+            return QString("Gaussian box %1").arg(pass + 1);
+        }
+        return QString("Gaussian blur 2D");
+    case BILATERAL_FILTER:
+        return stage.algorithm == 1 ? QString("Bilateral grid") : QString("Bilateral filter");
+    case SHARPENING:
+        return QString("Sharpening");
+    case EDGE_DETECTION:
+        if(stage.algorithm == CANNY_ALGORITHM) {
+            return pass < 5 ? QString(cannyNames[pass]) : QString("Canny hysteresis");
+        }
+        return QString(edgeNames[qBound(0, stage.algorithm, EDGE_ALGORITHM_COUNT - 1)]);
+    default:
+        return QString("Original");
+    }
+}
+
+/**
+ * Uses the right shader for a pass of a stage and sets its uniforms.
+ *
+ * @brief ImageProcessor::computeStage
+ * @param stage
+ * @param pass
+ * @param sourceTextureID the texture the pass reads
+ */
+void ImageProcessor::computeStage(const FilterStage& stage, int pass, GLuint sourceTextureID) {
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        if(stage.algorithm == 0) {
+            computeSeparableGaussianBlur(stage, pass == 0);
+        } else if(stage.algorithm == BOX_ALGORITHM) {
+            computeBoxBlur(qMin(stage.kernelSize, MAX_BOX_KERNEL_SIZE) / 2, sourceTextureID);
+        } else if(stage.algorithm == BOX_GAUSSIAN_ALGORITHM) {
+            int radii[BOX_GAUSSIAN_PASSES];
+            calculateBoxRadii(stage.deviation, radii);
+            computeBoxBlur(radii[pass], sourceTextureID);
+        } else {
+            computeGaussianBlur(stage);
+        }
+        break;
+    case BILATERAL_FILTER:
+        if(stage.algorithm == 1 && gl33 != NULL) {
+            computeBilateralGrid(stage, sourceTextureID);
+        } else {
+            computeBilateralFilter(stage);
+        }
+        break;
+    case SHARPENING:
+        computeSharpening(stage);
+        break;
+    case EDGE_DETECTION:
+        if(stage.algorithm == CANNY_ALGORITHM) {
+            computeCanny(stage, pass);
+        } else if(stage.algorithm > 0) {
+            computeEdgeGradient(stage.algorithm, false, 1.0f);
+        } else {
+            computeEdgeDetection();
+        }
+        break;
+    default:
+        shaderProgram->bind();
+        break;
+    }
+}
+
+/**
+ * Uses the shader for the gaussian blur algorithm.
+ * Gets the cached kernel and only uploads the uniforms that have changed.
+ *
+ * @brief ImageProcessor::computeGaussianBlur
+ * @param stage
+ */
+void ImageProcessor::computeGaussianBlur(const FilterStage& stage) {
+
+    // the 2D shader is limited to 9x9 kernels
+    int kernelSize = qMin(stage.kernelSize, MAX_KERNEL_SIZE);
+
+    // using the program specialized for the kernel size, or the generic one
+    QOpenGLShaderProgram* program = gbShaderProgram;
+    ShaderUniforms* uniforms = &gbUniforms;
+    ShaderVariant* variant = getShaderVariant(GAUSSIAN_BLUR, kernelSize);
+    if(variant != NULL) {
+        program = variant->program;
+        uniforms = &variant->uniforms;
+    }
+    program->bind();
+
+    // setting all the uniforms' value, the specialized programs have no kernel size
+    setUniform(program, uniforms->kernelSizeLocation, kernelSize, uniforms->kernelSize);
+    setUniform(program, uniforms->xOffsetLocation, xOffset, uniforms->xOffset);
+    setUniform(program, uniforms->yOffsetLocation, yOffset, uniforms->yOffset);
+    setUniform(program, uniforms->kernelValueLocation, getKernel(kernelSize, stage.deviation), uniforms->kernelValue);
+}
+
+/**
+ * Gets the program of an algorithm specialized for a kernel size, compiling it on first use.
+ * The size is defined as KERNEL_SIZE right after the #version line of the generic source:
+ * the loops have constant bounds and the kernel array has the size of the kernel.
+ * A program that does not link is not tried again.
+ *
+ * @brief ImageProcessor::getShaderVariant
+ * @param type GAUSSIAN_BLUR or BILATERAL_FILTER
+ * @param kernelSize
+ * @return the variant, NULL when it does not link
+ */
+ShaderVariant* ImageProcessor::getShaderVariant(FilterType type, int kernelSize) {
+    QPair<int, int> key(type, kernelSize);
+    if(!shaderVariants.contains(key)) {
+        ShaderVariant variant;
+        variant.program = NULL;
+
+        // the size is defined for the preprocessor of the generic source
+        QByteArray define = QByteArray("#define KERNEL_SIZE ") + QByteArray::number(kernelSize) + "\n";
+        QOpenGLShaderProgram* program = createProgram(type == GAUSSIAN_BLUR ? ":/shaders/gaussian_blur.fsh"
+                                                                           : ":/shaders/bilateral_filter.fsh", define);
+        if(program->isLinked()) {
+            variant.program = program;
+            resolveUniforms(program, variant.uniforms);
+        } else {
+            qWarning() << "cannot specialize the shader for the kernel size" << kernelSize << ":" << program->log();
+            delete program;
+        }
+        shaderVariants.insert(key, variant);
+    }
+
+    ShaderVariant& variant = shaderVariants[key];
+    return variant.program != NULL ? &variant : NULL;
+}
+
+/**
+ * Gets the compute program of an algorithm for a kernel size, compiling it on first use.
+ * The filter, the kernel size, the size of the work groups and the format of the targets
+ * are defined right after the #version line. A program that does not link is not tried again.
+ *
+ * @brief ImageProcessor::getComputeVariant
+ * @param type GAUSSIAN_BLUR, BILATERAL_FILTER or SHARPENING
+ * @param kernelSize
+ * @return the variant, NULL when it does not link
+ */
+ShaderVariant* ImageProcessor::getComputeVariant(FilterType type, int kernelSize) {
+    QPair<int, int> key(type, kernelSize);
+    if(!computeVariants.contains(key)) {
+        ShaderVariant variant;
+        variant.program = NULL;
+
+        // the definitions specializing the generic source
+        static const char* filterNames[] = { "GAUSSIAN_BLUR", "BILATERAL_FILTER", "SHARPENING" };
+        QByteArray defines = QByteArray("#define ") + filterNames[type == GAUSSIAN_BLUR ? 0 : (type == BILATERAL_FILTER ? 1 : 2)] + "\n"
+                + "#define KERNEL_SIZE " + QByteArray::number(kernelSize) + "\n"
+                + "#define TILE_SIZE " + QByteArray::number(COMPUTE_TILE_SIZE) + "\n"
+                + "#define OUTPUT_FORMAT " + (precision == LINEAR_FLOAT16 ? "rgba16f" : "rgba8") + "\n";
+        QFile file(":/shaders/convolution.csh");
+        file.open(QIODevice::ReadOnly);
+        QByteArray computeSource = file.readAll();
+        computeSource.insert(computeSource.indexOf('\n') + 1, defines);
+
+        QOpenGLShaderProgram* program = programCache.createComputeProgram(computeSource);
+        if(program->isLinked()) {
+            variant.program = program;
+            resolveUniforms(program, variant.uniforms);
+        } else {
+            qWarning() << "cannot create the compute shader for the kernel size" << kernelSize << ":" << program->log();
+            delete program;
+        }
+        computeVariants.insert(key, variant);
+    }
+
+    ShaderVariant& variant = computeVariants[key];
+    return variant.program != NULL ? &variant : NULL;
+}
+
+/**
+ * Gets the compute program running a stage in the current render.
+ * The stages without one, the mip levels, whose passes sample between the texels,
+ * and the contexts without opengl 4.3 use the fragment shaders.
+ *
+ * @brief ImageProcessor::getComputeStage
+ * @param stage
+ * @return the variant, NULL when the stage is rendered by a fragment shader
+ */
+ShaderVariant* ImageProcessor::getComputeStage(const FilterStage& stage) {
+    if(gl43 == NULL || !computeEnabled || renderLevel != 0) {
+        return NULL;
+    }
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        return stage.algorithm != 1 ? NULL : getComputeVariant(GAUSSIAN_BLUR, qMin(stage.kernelSize, MAX_KERNEL_SIZE));
+    case BILATERAL_FILTER:
+        return (stage.algorithm == 1 && gl33 != NULL) ? NULL : getComputeVariant(BILATERAL_FILTER, qMin(stage.kernelSize, MAX_KERNEL_SIZE));
+    case SHARPENING:
+        return getComputeVariant(SHARPENING, 3);
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Runs a stage with its compute program, a work group per tile of the image.
+ * The barrier makes the target's texels visible to the passes sampling or drawing it next.
+ *
+ * @brief ImageProcessor::dispatchStage
+ * @param stage
+ * @param variant the compute program of the stage
+ * @param sourceTextureID the texture the pass reads
+ * @param targetTextureID the texture the pass writes
+ */
+void ImageProcessor::dispatchStage(const FilterStage& stage, ShaderVariant* variant, GLuint sourceTextureID, GLuint targetTextureID) {
+    QOpenGLShaderProgram* program = variant->program;
+    ShaderUniforms& uniforms = variant->uniforms;
+    program->bind();
+
+    // setting the uniforms of the stage, the others are not declared
+    if(stage.type == SHARPENING) {
+        setUniform(program, uniforms.scaleFactorLocation, stage.scaleFactor, uniforms.scaleFactor);
+        setUniform(program, uniforms.kernelValueLocation, shKernel, uniforms.kernelValue);
+    } else {
+        int kernelSize = qMin(stage.kernelSize, MAX_KERNEL_SIZE);
+        setUniform(program, uniforms.rangeLocation, stage.range, uniforms.range);
+        setUniform(program, uniforms.kernelValueLocation, getKernel(kernelSize, stage.deviation), uniforms.kernelValue);
+    }
+
+    // reading the previous result, writing the pooled target
+    glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+    gl43->glBindImageTexture(0, targetTextureID, 0, GL_FALSE, 0, GL_WRITE_ONLY, getTargetFormat());
+    gl43->glDispatchCompute((renderWidth + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                            (renderHeight + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE, 1);
+    gl43->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    gl43->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, getTargetFormat());
+}
+
+/**
+ * Releases the compute programs, they are compiled again on their next use.
+ *
+ * @brief ImageProcessor::releaseComputeVariants
+ */
+void ImageProcessor::releaseComputeVariants() {
+    for(const ShaderVariant& variant : computeVariants) {
+        delete variant.program;
+    }
+    computeVariants.clear();
+}
+
+/**
+ * @brief ImageProcessor::isComputeAvailable
+ * @return whether the context runs compute shaders
+ */
+bool ImageProcessor::isComputeAvailable() const {
+    return gl43 != NULL;
+}
+
+/**
+ * Chooses between the compute shaders and the fragment shaders for the stages having both.
+ * The compute shaders are only used when the context supports them.
+ *
+ * @brief ImageProcessor::setComputeEnabled
+ * @param enabled
+ */
+void ImageProcessor::setComputeEnabled(bool enabled) {
+    computeEnabled = enabled;
+}
+
+/**
+ * @brief ImageProcessor::isComputeEnabled
+ * @return whether the compute shaders run the stages having one, when the context supports them
+ */
+bool ImageProcessor::isComputeEnabled() const {
+    return computeEnabled;
+}
+
+/**
+ * Uses the shader for the separable gaussian blur algorithm.
+ * Gets the cached one dimensional kernel.
+ * Only sets the offset of the direction the current pass is going through.
+ *
+ * @brief ImageProcessor::computeSeparableGaussianBlur
+ * @param stage
+ * @param horizontal
+ */
+void ImageProcessor::computeSeparableGaussianBlur(const FilterStage& stage, bool horizontal) {
+
+    // the separable shader is limited to 65 values kernels
+    int kernelSize = qMin(stage.kernelSize, MAX_SEPARABLE_KERNEL_SIZE);
+
+    // using the separable gaussian blur shader program
+    gbsShaderProgram->bind();
+
+    // setting all the uniforms' value
+    setUniform(gbsShaderProgram, gbsUniforms.kernelSizeLocation, kernelSize, gbsUniforms.kernelSize);
+    setUniform(gbsShaderProgram, gbsUniforms.xOffsetLocation, horizontal ? xOffset : 0.0f, gbsUniforms.xOffset);
+    setUniform(gbsShaderProgram, gbsUniforms.yOffsetLocation, horizontal ? 0.0f : yOffset, gbsUniforms.yOffset);
+    setUniform(gbsShaderProgram, gbsUniforms.kernelValueLocation, getKernel1D(kernelSize, stage.deviation), gbsUniforms.kernelValue);
+}
+
+/**
+ * Gets the kernel of a size and a deviation, it is only calculated the first time.
+ * The cache is emptied when it gets too big.
+ *
+ * @brief ImageProcessor::getKernel
+ * @param kernelSize
+ * @param deviation
+ * @return the kernel values
+ */
+const QVector<float>& ImageProcessor::getKernel(int kernelSize, float deviation) {
+    QPair<int, float> key(kernelSize, deviation);
+    QMap<QPair<int, float>, QVector<float> >::const_iterator it = kernelCache.constFind(key);
+    if(it != kernelCache.constEnd()) {
+        return it.value();
+    }
+
+    // calculating the missing kernel
+    if(kernelCache.size() >= KERNEL_CACHE_SIZE) {
+        kernelCache.clear();
+    }
+    QVector<float> kernel(kernelSize*kernelSize);
+    calculateKernel(kernel.data(), kernelSize, deviation);
+    return kernelCache.insert(key, kernel).value();
+}
+
+/**
+ * Gets the one dimensional kernel of a size and a deviation, it is only calculated the first time.
+ * The cache is emptied when it gets too big.
+ *
+ * @brief ImageProcessor::getKernel1D
+ * @param kernelSize
+ * @param deviation
+ * @return the kernel values
+ */
+const QVector<float>& ImageProcessor::getKernel1D(int kernelSize, float deviation) {
+    QPair<int, float> key(kernelSize, deviation);
+    QMap<QPair<int, float>, QVector<float> >::const_iterator it = kernel1DCache.constFind(key);
+    if(it != kernel1DCache.constEnd()) {
+        return it.value();
+    }
+
+    // calculating the missing kernel
+    if(kernel1DCache.size() >= KERNEL_CACHE_SIZE) {
+        kernel1DCache.clear();
+    }
+    QVector<float> kernel(kernelSize);
+    calculateKernel1D(kernel.data(), kernelSize, deviation);
+    return kernel1DCache.insert(key, kernel).value();
+}
+
+/**
+ * Gets the locations of all the uniforms of a linked shader program.
+ * Nothing has been uploaded to them yet.
+ *
+ * @brief ImageProcessor::resolveUniforms
+ * @param program
+ * @param uniforms
+ */
+void ImageProcessor::resolveUniforms(QOpenGLShaderProgram* program, ShaderUniforms& uniforms) {
+
+    // getting all the uniforms' location
+    uniforms.kernelSizeLocation = program->uniformLocation("kernel_size");
+    uniforms.xOffsetLocation = program->uniformLocation("x_offset");
+    uniforms.yOffsetLocation = program->uniformLocation("y_offset");
+    uniforms.rangeLocation = program->uniformLocation("range");
+    uniforms.scaleFactorLocation = program->uniformLocation("scale_factor");
+    uniforms.kernelValueLocation = program->uniformLocation("kernel_value");
+    uniforms.cellSizeLocation = program->uniformLocation("cell_size");
+    uniforms.layerLocation = program->uniformLocation("layer");
+    uniforms.axisLocation = program->uniformLocation("axis");
+    uniforms.orientationLocation = program->uniformLocation("orientation");
+    uniforms.lowThresholdLocation = program->uniformLocation("low_threshold");
+    uniforms.highThresholdLocation = program->uniformLocation("high_threshold");
+    uniforms.lastPassLocation = program->uniformLocation("last_pass");
+    uniforms.firstPassLocation = program->uniformLocation("first_pass");
+    uniforms.strideLocation = program->uniformLocation("stride");
+    uniforms.cellWidthLocation = program->uniformLocation("cell_width");
+    uniforms.cellHeightLocation = program->uniformLocation("cell_height");
+    uniforms.cellApronLocation = program->uniformLocation("cell_apron");
+    uniforms.imageWidthLocation = program->uniformLocation("image_width");
+    uniforms.imageHeightLocation = program->uniformLocation("image_height");
+
+    // values that no stage uses, so that the first one is always uploaded
+    uniforms.kernelSize = -1;
+    uniforms.xOffset = -1.0f;
+    uniforms.yOffset = 1.0f;
+    uniforms.range = -1.0f;
+    uniforms.scaleFactor = -1.0f;
+    uniforms.kernelValue.clear();
+    uniforms.cellSize = -1;
+    uniforms.layer = -1;
+    uniforms.axis = -1;
+    uniforms.orientation = -1;
+    uniforms.lowThreshold = -1.0f;
+    uniforms.highThreshold = -1.0f;
+    uniforms.lastPass = -1;
+    uniforms.firstPass = -1;
+    uniforms.stride = -1;
+    uniforms.cellWidth = -1;
+    uniforms.cellHeight = -1;
+    uniforms.cellApron = -1;
+    uniforms.imageWidth = -1;
+    uniforms.imageHeight = -1;
+}
+
+/**
+ * Sets an int uniform of the bound program, unless it already has this value.
+ *
+ * @brief ImageProcessor::setUniform
+ * @param program
+ * @param location
+ * @param value
+ * @param uploadedValue the value last uploaded, updated
+ */
+void ImageProcessor::setUniform(QOpenGLShaderProgram* program, int location, int value, int& uploadedValue) {
+    if(value != uploadedValue) {
+        program->setUniformValue(location, value);
+        uploadedValue = value;
+    }
+}
+
+/**
+ * Sets a float uniform of the bound program, unless it already has this value.
+ *
+ * @brief ImageProcessor::setUniform
+ * @param program
+ * @param location
+ * @param value
+ * @param uploadedValue the value last uploaded, updated
+ */
+void ImageProcessor::setUniform(QOpenGLShaderProgram* program, int location, float value, float& uploadedValue) {
+    if(value != uploadedValue) {
+        program->setUniformValue(location, value);
+        uploadedValue = value;
+    }
+}
+
+/**
+ * Sets a float array uniform of the bound program, unless it already has these values.
+ * The cached kernels are shared, so an unchanged kernel is compared without going through its values.
+ *
+ * @brief ImageProcessor::setUniform
+ * @param program
+ * @param location
+ * @param value
+ * @param uploadedValue the values last uploaded, updated
+ */
+void ImageProcessor::setUniform(QOpenGLShaderProgram* program, int location, const QVector<float>& value, QVector<float>& uploadedValue) {
+    if(value != uploadedValue) {
+        program->setUniformValueArray(location, value.constData(), value.size(), 1);
+        uploadedValue = value;
+    }
+}
+
+/**
+ * Calculates the kernel.
+ * @brief ImageProcessor::calculateKernel
+ * @param kernel
+ * @param kernelSize
+ * @param deviation
+ */
+void ImageProcessor::calculateKernel(float kernel[], int kernelSize, float deviation) {
+
+    // the sum of all the kernel values
+    float sum = 0.0;
+
+    // loops going from the upper left corner to the bottom right corner
+    int index = 0;
+    for(int y = kernelSize/2; y >= -kernelSize/2; y--) {
+        for(int x = -kernelSize/2; x <= kernelSize/2; x++) {
+
+            // calculating the value of the kernel in (x, y)
+            kernel[index] = (1.0 / (2.0*M_PI*deviation*deviation)) * exp(- ((x*x) + (y*y)) / (2*deviation*deviation));
+
+            // updating the sum
+            sum += kernel[index];
+            index++;
+        }
+    }
+
+    // normalizing the values in the kernel
+    for(int i = 0; i < kernelSize*kernelSize; i++) {
+        kernel[i] /= sum;
+    }
+
+}
+
+/**
+ * Calculates the one dimensional kernel.
+ * The 2D kernel is the product of this kernel through x and through y,
+ * so both gaussian blur paths give the same result.
+ *
+ * @brief ImageProcessor::calculateKernel1D
+ * @param kernel
+ * @param kernelSize
+ * @param deviation
+ */
+void ImageProcessor::calculateKernel1D(float kernel[], int kernelSize, float deviation) {
+
+    // the sum of all the kernel values
+    float sum = 0.0;
+
+    // loop going from one end to the other
+    int index = 0;
+    for(int x = -kernelSize/2; x <= kernelSize/2; x++) {
+
+        // calculating the value of the kernel in x
+        kernel[index] = exp(- (x*x) / (2*deviation*deviation));
+
+        // updating the sum
+        sum += kernel[index];
+        index++;
+    }
+
+    // normalizing the values in the kernel
+    for(int i = 0; i < kernelSize; i++) {
+        kernel[i] /= sum;
+    }
+}
+
+/**
+ * Uses the shader for the bilateral filter algorithm.
+ * Gets the cached kernel and only uploads the uniforms that have changed.
+ *
+ * @brief ImageProcessor::computeBilateralFilter
+ * @param stage
+ */
+void ImageProcessor::computeBilateralFilter(const FilterStage& stage) {
+
+    // the shader is limited to 9x9 kernels
+    int kernelSize = qMin(stage.kernelSize, MAX_KERNEL_SIZE);
+
+    // using the program specialized for the kernel size, or the generic one
+    QOpenGLShaderProgram* program = bfShaderProgram;
+    ShaderUniforms* uniforms = &bfUniforms;
+    ShaderVariant* variant = getShaderVariant(BILATERAL_FILTER, kernelSize);
+    if(variant != NULL) {
+        program = variant->program;
+        uniforms = &variant->uniforms;
+    }
+    program->bind();
+
+    // setting all the uniforms' value, the specialized programs have no kernel size
+    setUniform(program, uniforms->kernelSizeLocation, kernelSize, uniforms->kernelSize);
+    setUniform(program, uniforms->xOffsetLocation, xOffset, uniforms->xOffset);
+    setUniform(program, uniforms->yOffsetLocation, yOffset, uniforms->yOffset);
+    setUniform(program, uniforms->rangeLocation, stage.range, uniforms->range);
+    setUniform(program, uniforms->kernelValueLocation, getKernel(kernelSize, stage.deviation), uniforms->kernelValue);
+}
+
+/**
+ * Uses the shaders of the bilateral grid, a fast approximation of the bilateral filter.
+ * Splats the pixels into a 3D grid, with the cells covering the deviation in x and y
+ * and the layers covering the range in luminance, then blurs the grid through its three axes.
+ * The slicing shader is left bound: it reads the grid at each pixel's position and luminance.
+ * The cost does not depend on the deviation, as the grid gets smaller when the deviation grows.
+ *
+ * @brief ImageProcessor::computeBilateralGrid
+ * @param stage
+ * @param sourceTextureID the texture to filter
+ */
+void ImageProcessor::computeBilateralGrid(const FilterStage& stage, GLuint sourceTextureID) {
+
+    // a cell covers one deviation, fewer pixels at a mip level, but the grid cannot be bigger than the biggest 3D texture
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    int cellSize = qMax(qMax(1, gridCellSize(stage) >> renderLevel), (qMax(renderWidth, renderHeight) + maxSize - 1) / maxSize);
+
+    // a layer covers one range, the luminance goes from 0 to 1
+    float range = qMax(stage.range, 1.0f / (maxSize - 1));
+    int width = (renderWidth + cellSize - 1) / cellSize;
+    int height = (renderHeight + cellSize - 1) / cellSize;
+    int depth = (int)ceil(1.0f / range) + 1;
+    if(width != bilateralGrid.width || height != bilateralGrid.height || depth != bilateralGrid.depth) {
+        createBilateralGrid(width, height, depth);
+    }
+
+    // rendering into the layers of the grid
+    glBindFramebuffer(GL_FRAMEBUFFER, bilateralGrid.fboID);
+    glViewport(0, 0, width, height);
+
+    // splatting the image into the first texture
+    bgSplatShaderProgram->bind();
+    setUniform(bgSplatShaderProgram, bgSplatUniforms.cellSizeLocation, cellSize, bgSplatUniforms.cellSize);
+    setUniform(bgSplatShaderProgram, bgSplatUniforms.rangeLocation, range, bgSplatUniforms.range);
+    glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+    for(int layer = 0; layer < depth; layer++) {
+        gl33->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, bilateralGrid.textureIDs[0], 0, layer);
+        setUniform(bgSplatShaderProgram, bgSplatUniforms.layerLocation, layer, bgSplatUniforms.layer);
+        drawQuad();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // blurring through x, y then the layers, going back and forth between the textures
+    bgBlurShaderProgram->bind();
+    for(int axis = 0; axis < 3; axis++) {
+        glBindTexture(GL_TEXTURE_3D, bilateralGrid.textureIDs[axis % 2]);
+        setUniform(bgBlurShaderProgram, bgBlurUniforms.axisLocation, axis, bgBlurUniforms.axis);
+        for(int layer = 0; layer < depth; layer++) {
+            gl33->glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, bilateralGrid.textureIDs[(axis + 1) % 2], 0, layer);
+            setUniform(bgBlurShaderProgram, bgBlurUniforms.layerLocation, layer, bgBlurUniforms.layer);
+            drawQuad();
+        }
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // the third blur ended in the second texture, the slicing reads it on the second unit
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, bilateralGrid.textureIDs[1]);
+    glActiveTexture(GL_TEXTURE0);
+
+    // using the slicing shader program
+    bgSliceShaderProgram->bind();
+    setUniform(bgSliceShaderProgram, bgSliceUniforms.cellSizeLocation, cellSize, bgSliceUniforms.cellSize);
+    setUniform(bgSliceShaderProgram, bgSliceUniforms.rangeLocation, range, bgSliceUniforms.range);
+}
+
+/**
+ * Creates the two 3D textures of the bilateral grid, in half floats, and the frame buffer object rendering into them.
+ * The previous grid is released.
+ *
+ * @brief ImageProcessor::createBilateralGrid
+ * @param width
+ * @param height
+ * @param depth
+ */
+void ImageProcessor::createBilateralGrid(int width, int height, int depth) {
+    releaseBilateralGrid();
+
+    for(int i = 0; i < 2; i++) {
+        glGenTextures(1, &bilateralGrid.textureIDs[i]);
+        glBindTexture(GL_TEXTURE_3D, bilateralGrid.textureIDs[i]);
+        gl33->glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, width, height, depth, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // the layers are attached one by one while rendering
+    glGenFramebuffers(1, &bilateralGrid.fboID);
+    bilateralGrid.width = width;
+    bilateralGrid.height = height;
+    bilateralGrid.depth = depth;
+}
+
+/**
+ * Releases the textures of the bilateral grid and its frame buffer object.
+ *
+ * @brief ImageProcessor::releaseBilateralGrid
+ */
+void ImageProcessor::releaseBilateralGrid() {
+    if(bilateralGrid.fboID != 0) {
+        glDeleteFramebuffers(1, &bilateralGrid.fboID);
+        glDeleteTextures(2, bilateralGrid.textureIDs);
+        bilateralGrid.fboID = 0;
+        bilateralGrid.textureIDs[0] = bilateralGrid.textureIDs[1] = 0;
+    }
+    bilateralGrid.width = bilateralGrid.height = bilateralGrid.depth = 0;
+}
+
+/**
+ * Uses the shader reading a box from the summed-area table, after building the table of the previous result.
+ * The table is summed through x then y, each pass adding SAT_RADIX texels of the previous one,
+ * so that it takes a logarithmic number of passes whatever the box's size.
+ * The first pass converts the colors to integers, the passes whose stride goes past the render are skipped.
+ * The table is left on the second unit for the box shader, which is left bound.
+ *
+ * @brief ImageProcessor::computeBoxBlur
+ * @param radius the radius of the box at the image's size, it covers fewer pixels at a mip level
+ * @param sourceTextureID the texture the pass reads
+ */
+void ImageProcessor::computeBoxBlur(int radius, GLuint sourceTextureID) {
+
+    // the table has the size of the render
+    if(satTargets[0].fboID == 0 || satWidth != renderWidth || satHeight != renderHeight) {
+        releaseSummedAreaTable();
+        for(int i = 0; i < 2; i++) {
+            createRenderTarget(satTargets[i], renderWidth, renderHeight, GL_RGBA32UI);
+        }
+        satWidth = renderWidth;
+        satHeight = renderHeight;
+    }
+    float scale = precision == LINEAR_FLOAT16 ? SAT_LINEAR_SCALE : SAT_GAMMA_SCALE;
+
+    // summing through x then y, going back and forth between the tables
+    satScanShaderProgram->bind();
+    setUniform(satScanShaderProgram, satScanUniforms.scaleFactorLocation, scale, satScanUniforms.scaleFactor);
+    glViewport(0, 0, renderWidth, renderHeight);
+    glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+    int target = 0;
+    bool first = true;
+    for(int axis = 0; axis < 2; axis++) {
+        int length = axis == 0 ? renderWidth : renderHeight;
+        for(int stride = 1; first || stride < length; stride *= SAT_RADIX) {
+            glBindFramebuffer(GL_FRAMEBUFFER, satTargets[target].fboID);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, first ? 0 : satTargets[1 - target].textureID);
+            glActiveTexture(GL_TEXTURE0);
+            setUniform(satScanShaderProgram, satScanUniforms.firstPassLocation, first ? 1 : 0, satScanUniforms.firstPass);
+            setUniform(satScanShaderProgram, satScanUniforms.axisLocation, axis, satScanUniforms.axis);
+            setUniform(satScanShaderProgram, satScanUniforms.strideLocation, stride, satScanUniforms.stride);
+            drawQuad();
+            target = 1 - target;
+            first = false;
+        }
+    }
+
+    // the last pass ended in the other table, the box shader reads it on the second unit
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, satTargets[1 - target].textureID);
+    glActiveTexture(GL_TEXTURE0);
+
+    // using the box shader program
+    satBoxShaderProgram->bind();
+    setUniform(satBoxShaderProgram, satBoxUniforms.kernelSizeLocation, 2 * (radius >> renderLevel) + 1, satBoxUniforms.kernelSize);
+    setUniform(satBoxShaderProgram, satBoxUniforms.scaleFactorLocation, scale, satBoxUniforms.scaleFactor);
+    setCellUniforms(satBoxShaderProgram, satBoxUniforms);
+}
+
+/**
+ * Sets the cells the pixels of the current render belong to: the cells of the loaded atlas,
+ * or a single cell of the render's size without any apron.
+ *
+ * @brief ImageProcessor::setCellUniforms
+ * @param program the bound program
+ * @param uniforms its uniforms
+ */
+void ImageProcessor::setCellUniforms(QOpenGLShaderProgram* program, ShaderUniforms& uniforms) {
+    bool atlas = atlasCellSize.isValid();
+    setUniform(program, uniforms.cellWidthLocation, atlas ? atlasCellSize.width() : renderWidth, uniforms.cellWidth);
+    setUniform(program, uniforms.cellHeightLocation, atlas ? atlasCellSize.height() : renderHeight, uniforms.cellHeight);
+    setUniform(program, uniforms.cellApronLocation, atlas ? atlasApron : 0, uniforms.cellApron);
+    setUniform(program, uniforms.imageWidthLocation, atlas ? atlasImageSize.width() : renderWidth, uniforms.imageWidth);
+    setUniform(program, uniforms.imageHeightLocation, atlas ? atlasImageSize.height() : renderHeight, uniforms.imageHeight);
+}
+
+/**
+ * Releases the textures of the summed-area table and their frame buffer objects.
+ *
+ * @brief ImageProcessor::releaseSummedAreaTable
+ */
+void ImageProcessor::releaseSummedAreaTable() {
+    for(int i = 0; i < 2; i++) {
+        releaseRenderTarget(satTargets[i]);
+    }
+    satWidth = 0;
+    satHeight = 0;
+}
+
+/**
+ * Gets the number of passes building a summed-area table.
+ *
+ * @brief ImageProcessor::satScanPassCount
+ * @param width
+ * @param height
+ * @return the passes through x, at least the converting one, and the passes through y
+ */
+int ImageProcessor::satScanPassCount(int width, int height) {
+    int count = 1;
+    for(int stride = SAT_RADIX; stride < width; stride *= SAT_RADIX) {
+        count++;
+    }
+    for(int stride = 1; stride < height; stride *= SAT_RADIX) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Measures the quality of the bilateral grid against the exact bilateral filter on the loaded image.
+ * Both are rendered at the image's size and read back.
+ *
+ * @brief ImageProcessor::measureBilateralGridPSNR
+ * @param stage the parameters of the bilateral filter
+ * @return the PSNR in dB, 0 when no image is loaded
+ */
+double ImageProcessor::measureBilateralGridPSNR(const FilterStage& stage) {
+    if(imageTextureID == 0) {
+        return 0.0;
+    }
+
+    FilterStage exactStage = stage;
+    exactStage.algorithm = 0;
+    FilterStage gridStage = stage;
+    gridStage.algorithm = 1;
+
+    // rendering both at the image's size
+    QImage exact = renderImage(QList<FilterStage>() << exactStage);
+    QImage grid = renderImage(QList<FilterStage>() << gridStage);
+
+    return computePSNR(exact, grid);
+}
+
+/**
+ * Computes the peak signal-to-noise ratio of an image against a reference of the same size,
+ * on the rgb channels.
+ *
+ * @brief ImageProcessor::computePSNR
+ * @param reference
+ * @param image
+ * @return the PSNR in dB, infinite when both are the same
+ */
+double ImageProcessor::computePSNR(const QImage& reference, const QImage& image) {
+    QImage first = reference.convertToFormat(QImage::Format_RGBA8888);
+    QImage second = image.convertToFormat(QImage::Format_RGBA8888);
+
+    // summing the squared errors
+    double sum = 0.0;
+    for(int y = 0; y < first.height(); y++) {
+        const uchar* firstLine = first.constScanLine(y);
+        const uchar* secondLine = second.constScanLine(y);
+        for(int x = 0; x < first.width(); x++) {
+            for(int c = 0; c < 3; c++) {
+                double error = firstLine[4*x + c] - secondLine[4*x + c];
+                sum += error * error;
+            }
+        }
+    }
+
+    double mse = sum / (3.0 * first.width() * first.height());
+    if(mse == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+/**
+ * Gets the number of pixels covered by a cell of the bilateral grid in x and in y: one deviation.
+ *
+ * @brief ImageProcessor::gridCellSize
+ * @param stage
+ * @return the size in pixels
+ */
+int ImageProcessor::gridCellSize(const FilterStage& stage) {
+    return qMax(1, qRound(stage.deviation));
+}
+
+/**
+ * Gets how far from a pixel a stage reads, through all its passes.
+ * The separable gaussian blur goes as far through x and y as the 2D kernel,
+ * Canny reads its smoothing, its gradient, its suppression and a pixel per hysteresis pass,
+ * the bilateral grid reads the splatted cell, two blurred cells and the interpolated one on each side.
+ *
+ * @brief ImageProcessor::stageRadius
+ * @param stage
+ * @return the radius in pixels
+ */
+int ImageProcessor::stageRadius(const FilterStage& stage) {
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        if(stage.algorithm == BOX_ALGORITHM) {
+            return qMin(stage.kernelSize, MAX_BOX_KERNEL_SIZE) / 2;
+        } else if(stage.algorithm == BOX_GAUSSIAN_ALGORITHM) {
+            int radii[BOX_GAUSSIAN_PASSES];
+            calculateBoxRadii(stage.deviation, radii);
+            return radii[0] + radii[1] + radii[2];
+        }
+        return qMin(stage.kernelSize, stage.algorithm == 0 ? MAX_SEPARABLE_KERNEL_SIZE : MAX_KERNEL_SIZE) / 2;
+    case BILATERAL_FILTER:
+        return stage.algorithm == 1 ? 4 * gridCellSize(stage) : qMin(stage.kernelSize, MAX_KERNEL_SIZE) / 2;
+    case EDGE_DETECTION:
+        return stage.algorithm == CANNY_ALGORITHM ? CANNY_KERNEL_SIZE / 2 + 2 + CANNY_HYSTERESIS_PASSES : 1;
+    default:
+        return 1;
+    }
+}
+
+/**
+ * Gets how far from a pixel the whole pipeline reads, the radii of the stages add up.
+ *
+ * @brief ImageProcessor::pipelineRadius
+ * @param pipeline
+ * @return the radius in pixels
+ */
+int ImageProcessor::pipelineRadius(const QList<FilterStage>& pipeline) {
+    int radius = 0;
+    for(const FilterStage& stage : pipeline) {
+        radius += stageRadius(stage);
+    }
+    return radius;
+}
+
+/**
+ * Renders the pipeline on the loaded image at its own size and reads the result back.
+ * Does not depend on any window, nor on its size.
+ * No other render may be pending.
+ *
+ * @brief ImageProcessor::renderImage
+ * @param pipeline
+ * @return the processed image, in QImage::Format_RGBA8888
+ */
+QImage ImageProcessor::renderImage(const QList<FilterStage>& pipeline) {
+    startRender(pipeline);
+    return takeRenderedImage();
+}
+
+/**
+ * Renders the pipeline on the loaded image at its own size and starts reading the result back.
+ * The result is read into a pixel buffer object and a fence is put after it,
+ * the cpu does not wait for the gpu until takeRenderedImage is called.
+ * Two renders can be read back at once, a third one waits for the oldest and keeps its result until it is taken.
+ *
+ * @brief ImageProcessor::startRender
+ * @param pipeline
+ */
+void ImageProcessor::startRender(const QList<FilterStage>& pipeline) {
+    if(pendingReadbackCount == READBACK_COUNT) {
+        finishedImages.append(takeReadback());
+    }
+
+    // the export target follows the size of the image, and keeps its 16 bits,
+    // its 8 bits format is sized so that the compute shaders can write into it
+    if(exportTarget.fboID == 0 || exportWidth != imageWidth || exportHeight != imageHeight || exportDeep != imageDeep) {
+        releaseRenderTarget(exportTarget);
+        createRenderTarget(exportTarget, imageWidth, imageHeight, imageDeep ? GL_RGBA16 : GL_RGBA8);
+        exportWidth = imageWidth;
+        exportHeight = imageHeight;
+        exportDeep = imageDeep;
+    }
+    render(pipeline, exportTarget.fboID, imageWidth, imageHeight);
+
+    // taking the next readback
+    Readback& readback = readbacks[(firstReadback + pendingReadbackCount) % READBACK_COUNT];
+    pendingReadbackCount++;
+    readback.width = imageWidth;
+    readback.height = imageHeight;
+    readback.deep = imageDeep;
+    GLenum type = imageDeep ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, exportTarget.fboID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if(gl33 != NULL) {
+
+        // reading into the pixel buffer object, the call returns before the gpu is done
+        int size = (imageDeep ? 8 : 4) * imageWidth * imageHeight;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.bufferID);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        glReadPixels(0, 0, imageWidth, imageHeight, GL_RGBA, type, NULL);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = gl33->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    } else {
+
+        // reading right away
+        readback.image = QImage(imageWidth, imageHeight, readbackFormat(imageDeep));
+        glReadPixels(0, 0, imageWidth, imageHeight, GL_RGBA, type, readback.image.bits());
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * @brief ImageProcessor::getPendingRenderCount
+ * @return the number of renders started and not taken yet
+ */
+int ImageProcessor::getPendingRenderCount() const {
+    return finishedImages.size() + pendingReadbackCount;
+}
+
+/**
+ * Gets the result of the oldest pending render.
+ *
+ * @brief ImageProcessor::takeRenderedImage
+ * @return the processed image, in QImage::Format_RGBA8888 or QImage::Format_RGBA64 for the 16 bits images,
+ * a null image when no render is pending
+ */
+QImage ImageProcessor::takeRenderedImage() {
+    if(!finishedImages.isEmpty()) {
+        return finishedImages.takeFirst();
+    }
+    return takeReadback();
+}
+
+/**
+ * Gets the result of the oldest readback and frees it.
+ * Waits for its fence, then maps its pixel buffer object.
+ *
+ * @brief ImageProcessor::takeReadback
+ * @return the processed image, a null image when no readback is pending
+ */
+QImage ImageProcessor::takeReadback() {
+    if(pendingReadbackCount == 0) {
+        return QImage();
+    }
+    Readback& readback = readbacks[firstReadback];
+    firstReadback = (firstReadback + 1) % READBACK_COUNT;
+    pendingReadbackCount--;
+
+    // the image has already been read
+    if(readback.fence == 0) {
+        QImage image = readback.image;
+        readback.image = QImage();
+        return image;
+    }
+
+    // waiting for the gpu, the pending commands are flushed so that the fence can be reached
+    GLenum status = GL_TIMEOUT_EXPIRED;
+    while(status == GL_TIMEOUT_EXPIRED) {
+        status = gl33->glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    gl33->glDeleteSync(readback.fence);
+    readback.fence = 0;
+    if(status == GL_WAIT_FAILED) {
+        qWarning("the readback of a render failed");
+        return QImage();
+    }
+
+    // copying the mapped pixels, the rows are already in the image's order
+    QImage image(readback.width, readback.height, readbackFormat(readback.deep));
+    int size = (readback.deep ? 8 : 4) * readback.width * readback.height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.bufferID);
+    const uchar* buffer = (const uchar*)gl33->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if(buffer != NULL) {
+        memcpy(image.bits(), buffer, size);
+        gl33->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        qWarning("the readback of a render cannot be mapped");
+        image = QImage();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return image;
+}
+
+/**
+ * @brief ImageProcessor::readbackFormat
+ * @param deep whether the image has 16 bits per channel
+ * @return the format of the images read back
+ */
+QImage::Format ImageProcessor::readbackFormat(bool deep) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    if(deep) {
+        return QImage::Format_RGBA64;
+    }
+#else
+    Q_UNUSED(deep);
+#endif
+    return QImage::Format_RGBA8888;
+}
+
+/**
+ * Runs the pipeline on an image of any size, one tile after the other.
+ * Each tile is loaded with an apron of the pipeline's radius around it, so that its border pixels
+ * read the same neighbors as in the whole image, and only its center is kept.
+ * The apron stops at the borders of the image, where the textures clamp to the edge as with the whole image.
+ * The gpu only holds the objects of one tile and the readbacks of two, the loaded image is replaced by the last tile.
+ * No other render may be pending.
+ *
+ * @brief ImageProcessor::processTiled
+ * @param image
+ * @param pipeline
+ * @param tileSize the size of the kept part of each tile
+ * @return the processed image, in the format of takeRenderedImage, a null image when the apron does not fit in a texture
+ */
+QImage ImageProcessor::processTiled(const QImage& image, const QList<FilterStage>& pipeline, int tileSize) {
+    int apron = pipelineRadius(pipeline);
+
+    // the cells of the bilateral grids have to start at the same pixels in every tile
+    int alignment = pipelineAlignment(pipeline);
+    apron = (apron + alignment - 1) / alignment * alignment;
+
+    // a tile and its apron have to fit in a texture
+    int maxTileSize = (getMaxTextureSize() - 2*apron) / alignment * alignment;
+    if(maxTileSize <= 0) {
+        qWarning("the pipeline reads too far to be processed in tiles");
+        return QImage();
+    }
+    tileSize = qBound(alignment, tileSize / alignment * alignment, maxTileSize);
+
+    QImage result(image.size(), readbackFormat(isDeepImage(image)));
+    QList<QRect> keptRects;
+    QList<QRect> loadedRects;
+    for(int y = 0; y < image.height(); y += tileSize) {
+        for(int x = 0; x < image.width(); x += tileSize) {
+
+            // the kept part of the tile and the part loaded with the apron
+            QRect keptRect(x, y, qMin(tileSize, image.width() - x), qMin(tileSize, image.height() - y));
+            QRect loadedRect = keptRect.adjusted(-apron, -apron, apron, apron).intersected(image.rect());
+
+            // processing the tile at its own size, while the previous one is read back
+            loadImage(image.copy(loadedRect));
+            startRender(pipeline);
+            keptRects.append(keptRect);
+            loadedRects.append(loadedRect);
+            if(getPendingRenderCount() > 1) {
+                copyTile(takeRenderedImage(), keptRects.takeFirst(), loadedRects.takeFirst(), result);
+            }
+        }
+    }
+
+    // the last tile
+    while(getPendingRenderCount() > 0) {
+        copyTile(takeRenderedImage(), keptRects.takeFirst(), loadedRects.takeFirst(), result);
+    }
+    return result;
+}
+
+/**
+ * Copies the center of a processed tile into the result.
+ *
+ * @brief ImageProcessor::copyTile
+ * @param tile the processed tile, with its apron
+ * @param keptRect where its center goes in the result
+ * @param loadedRect where the tile and its apron come from
+ * @param result
+ */
+void ImageProcessor::copyTile(const QImage& tile, const QRect& keptRect, const QRect& loadedRect, QImage& result) {
+    if(tile.isNull()) {
+        return;
+    }
+
+    int left = keptRect.x() - loadedRect.x();
+    int top = keptRect.y() - loadedRect.y();
+    int bytes = tile.depth() / 8;
+    for(int row = 0; row < keptRect.height(); row++) {
+        memcpy(result.scanLine(keptRect.y() + row) + bytes*keptRect.x(),
+               tile.constScanLine(top + row) + bytes*left,
+               bytes*keptRect.width());
+    }
+}
+
+/**
+ * Gets the number of pixels the tiles and the cells of an atlas have to be aligned on,
+ * so that the cells of the bilateral grids start at the same pixels as in the whole image.
+ *
+ * @brief ImageProcessor::pipelineAlignment
+ * @param pipeline
+ * @return the least common multiple of the grids' cell sizes, 1 without any grid
+ */
+int ImageProcessor::pipelineAlignment(const QList<FilterStage>& pipeline) {
+    int alignment = 1;
+    for(const FilterStage& stage : pipeline) {
+        if(stage.type == BILATERAL_FILTER && stage.algorithm == 1) {
+            int cellSize = gridCellSize(stage);
+            int a = alignment;
+            int b = cellSize;
+            while(b != 0) {
+                int r = a % b;
+                a = b;
+                b = r;
+            }
+            alignment = alignment / a * cellSize;
+        }
+    }
+    return alignment;
+}
+
+/**
+ * Gets the size of the cell an image takes in an atlas: the image and an apron around it.
+ * The aprons are replicated again before the passes reading them, so the apron only has to be as wide
+ * as the widest stage; the boxes stop at the cells and read none of it.
+ *
+ * @brief ImageProcessor::atlasCell
+ * @param imageSize
+ * @param pipeline
+ * @param apron the width of the apron
+ * @param cellSize the size of the cell, aligned as the pipeline needs
+ */
+void ImageProcessor::atlasCell(const QSize& imageSize, const QList<FilterStage>& pipeline, int& apron, QSize& cellSize) {
+    int alignment = pipelineAlignment(pipeline);
+    int radius = 0;
+    for(const FilterStage& stage : pipeline) {
+        if(stage.type != GAUSSIAN_BLUR || stage.algorithm < BOX_ALGORITHM) {
+            radius = qMax(radius, stageRadius(stage));
+        }
+    }
+    apron = (radius + alignment - 1) / alignment * alignment;
+    cellSize = QSize((imageSize.width() + 2*apron + alignment - 1) / alignment * alignment,
+                     (imageSize.height() + 2*apron + alignment - 1) / alignment * alignment);
+}
+
+/**
+ * Gets the number of images of a size that fit in one atlas.
+ * The bilateral grid is not packed: its blur goes from the cells of an image to the ones of its apron,
+ * where the grid of the image alone stops at its edges.
+ *
+ * @brief ImageProcessor::atlasCapacity
+ * @param imageSize
+ * @param pipeline
+ * @return the number of cells of the biggest atlas, 0 when the image does not fit in it, 1 when it is not packed
+ */
+int ImageProcessor::atlasCapacity(const QSize& imageSize, const QList<FilterStage>& pipeline) {
+    for(const FilterStage& stage : pipeline) {
+        if(stage.type == BILATERAL_FILTER && stage.algorithm == 1) {
+            return 1;
+        }
+    }
+
+    int apron = 0;
+    QSize cellSize;
+    atlasCell(imageSize, pipeline, apron, cellSize);
+    int atlasSize = qMin(getMaxTextureSize(), ATLAS_SIZE);
+    return (atlasSize / cellSize.width()) * (atlasSize / cellSize.height());
+}
+
+/**
+ * Runs the pipeline on many small images of the same size with as few renders as possible.
+ * The images are packed into the cells of an atlas, which is uploaded, rendered and read back at once:
+ * the cost of the calls is paid once per atlas rather than once per image.
+ * Each cell has an apron in which the image's edges are replicated, so that its pixels read the same neighbors
+ * as when the image is clamped to its own edges. Before each later pass reading the aprons, they are replicated
+ * again from the previous result, as the standalone render clamps each intermediate result.
+ * No other render may be pending.
+ *
+ * @brief ImageProcessor::processAtlas
+ * @param images the images, all of the same size
+ * @param pipeline
+ * @return the processed images in the same order, in QImage::Format_RGBA8888, null ones when the render failed
+ */
+QList<QImage> ImageProcessor::processAtlas(const QList<QImage>& images, const QList<FilterStage>& pipeline) {
+    QList<QImage> results;
+    if(images.isEmpty()) {
+        return results;
+    }
+
+    // as many cells as fit in the biggest atlas
+    QSize imageSize = images[0].size();
+    int apron = 0;
+    QSize cellSize;
+    atlasCell(imageSize, pipeline, apron, cellSize);
+    int atlasSize = qMin(getMaxTextureSize(), ATLAS_SIZE);
+    int columns = atlasSize / cellSize.width();
+    int capacity = columns * (atlasSize / cellSize.height());
+    if(capacity == 0) {
+        qWarning("the images are too big to be packed into an atlas");
+        return results;
+    }
+
+    for(int first = 0; first < images.size(); first += capacity) {
+        int count = qMin(capacity, images.size() - first);
+
+        // packing the images row by row, the last atlas is only as high as needed
+        QImage atlas(qMin(count, columns) * cellSize.width(), (count + columns - 1) / columns * cellSize.height(), QImage::Format_RGBA8888);
+        QList<QRect> cellRects;
+        for(int i = 0; i < count; i++) {
+            QRect cellRect(QPoint((i % columns) * cellSize.width(), (i / columns) * cellSize.height()), cellSize);
+            copyPadded(images[first + i].convertToFormat(QImage::Format_RGBA8888), apron, cellRect, atlas);
+            cellRects.append(cellRect);
+        }
+
+        // one upload, one render and one readback for all of them
+        loadImage(atlas);
+        atlasCellSize = cellSize;
+        atlasImageSize = imageSize;
+        atlasApron = apron;
+        QImage result = renderImage(pipeline);
+        atlasCellSize = QSize();
+        for(const QRect& cellRect : cellRects) {
+            results.append(result.isNull() ? QImage() : result.copy(QRect(cellRect.topLeft() + QPoint(apron, apron), imageSize)));
+        }
+    }
+    return results;
+}
+
+/**
+ * Tells whether a pass reads the aprons of an atlas' cells, which then have to repeat the edges of the previous result.
+ * The second pass of a separable blur reads the first one's results in the aprons, which are already the ones
+ * of the clamped edges since each apron row is a copy of an edge row. The boxes stop at the cells,
+ * the threshold of Canny only reads its pixel.
+ *
+ * @brief ImageProcessor::readsAprons
+ * @param stage
+ * @param pass
+ * @return false when the pass reads the cells as they are
+ */
+bool ImageProcessor::readsAprons(const FilterStage& stage, int pass) {
+    switch(stage.type) {
+    case GAUSSIAN_BLUR:
+        return stage.algorithm == 0 ? pass == 0 : stage.algorithm < BOX_ALGORITHM;
+    case EDGE_DETECTION:
+        return stage.algorithm != CANNY_ALGORITHM || (pass != 1 && pass != 4);
+    default:
+        return true;
+    }
+}
+
+/**
+ * Copies the previous result into the next pooled target, each apron repeating the nearest edge of its image.
+ *
+ * @brief ImageProcessor::replicateAprons
+ * @param sourceTextureID the previous result
+ * @param target the pooled target receiving the copy
+ */
+void ImageProcessor::replicateAprons(GLuint sourceTextureID, int target) {
+    atlasApronShaderProgram->bind();
+    setCellUniforms(atlasApronShaderProgram, atlasApronUniforms);
+    bindRenderTarget(target);
+    glBindTexture(GL_TEXTURE_2D, sourceTextureID);
+    drawQuad();
+}
+
+/**
+ * Copies an image into its cell of an atlas, after an apron on its top and left sides.
+ * The rest of the cell repeats the image's nearest edge, as a texture clamped to its edges would.
+ *
+ * @brief ImageProcessor::copyPadded
+ * @param image the image, in QImage::Format_RGBA8888
+ * @param apron
+ * @param cellRect the cell in the atlas
+ * @param atlas
+ */
+void ImageProcessor::copyPadded(const QImage& image, int apron, const QRect& cellRect, QImage& atlas) {
+    int width = image.width();
+    for(int row = 0; row < cellRect.height(); row++) {
+        const quint32* source = (const quint32*)image.constScanLine(qBound(0, row - apron, image.height() - 1));
+        quint32* line = (quint32*)atlas.scanLine(cellRect.y() + row) + cellRect.x();
+        for(int column = 0; column < apron; column++) {
+            line[column] = source[0];
+        }
+        memcpy(line + apron, source, 4*width);
+        for(int column = apron + width; column < cellRect.width(); column++) {
+            line[column] = source[width - 1];
+        }
+    }
+}
+
+/**
+ * Uses the shader for the sharpening algorithm.
+ * Only uploads the uniforms that have changed.
+ *
+ * @brief ImageProcessor::computeSharpening
+ * @param stage
+ */
+void ImageProcessor::computeSharpening(const FilterStage& stage) {
+
+    // using the sharpening shader program
+    shShaderProgram->bind();
+
+    // setting all the uniforms' value
+    setUniform(shShaderProgram, shUniforms.xOffsetLocation, xOffset, shUniforms.xOffset);
+    setUniform(shShaderProgram, shUniforms.yOffsetLocation, yOffset, shUniforms.yOffset);
+    setUniform(shShaderProgram, shUniforms.scaleFactorLocation, stage.scaleFactor, shUniforms.scaleFactor);
+    setUniform(shShaderProgram, shUniforms.kernelValueLocation, shKernel, shUniforms.kernelValue);
+}
+
+/**
+ * Uses the shader for the LoG edge detection.
+ * Its kernel is calculated once.
+ *
+ * @brief ImageProcessor::computeEdgeDetection
+ */
+void ImageProcessor::computeEdgeDetection() {
+
+    // using the edge detection shader program
+    edShaderProgram->bind();
+
+    // setting all the uniforms' value
+    setUniform(edShaderProgram, edUniforms.xOffsetLocation, xOffset, edUniforms.xOffset);
+    setUniform(edShaderProgram, edUniforms.yOffsetLocation, yOffset, edUniforms.yOffset);
+    setUniform(edShaderProgram, edUniforms.kernelValueLocation, edKernels[0], edUniforms.kernelValue);
+}
+
+/**
+ * Uses the shader computing the gradient of Sobel or Prewitt in one pass:
+ * both kernels are applied to the same samples and their magnitude is drawn.
+ *
+ * @brief ImageProcessor::computeEdgeGradient
+ * @param algorithm 1 for Sobel, 2 for Prewitt
+ * @param orientation whether the direction of the gradient is drawn in the green and blue channels
+ * @param scale the factor applied to the magnitude
+ */
+void ImageProcessor::computeEdgeGradient(int algorithm, bool orientation, float scale) {
+
+    // getting the x kernel, the shader turns it for y
+    const QVector<float>& kernel = edKernels[qBound(1, algorithm, EDGE_ALGORITHM_COUNT - 1)];
+
+    // using the gradient shader program
+    egShaderProgram->bind();
+
+    // setting all the uniforms' value
+    setUniform(egShaderProgram, egUniforms.xOffsetLocation, xOffset, egUniforms.xOffset);
+    setUniform(egShaderProgram, egUniforms.yOffsetLocation, yOffset, egUniforms.yOffset);
+    setUniform(egShaderProgram, egUniforms.kernelValueLocation, kernel, egUniforms.kernelValue);
+    setUniform(egShaderProgram, egUniforms.orientationLocation, orientation ? 1 : 0, egUniforms.orientation);
+    setUniform(egShaderProgram, egUniforms.scaleFactorLocation, scale, egUniforms.scaleFactor);
+}
+
+/**
+ * Uses the shader of a pass of Canny.
+ * The image is smoothed by the separable gaussian blur, then the Sobel gradient is drawn with its direction,
+ * its magnitude divided by 4*sqrt(2) so that it fits the 8 bits targets without being clamped,
+ * the thresholds are given in this normalized magnitude. The pixels which are not the biggest across the edge are suppressed and the others are thresholded
+ * into strong and weak edges. Each hysteresis pass turns the weak edges next to a strong one into strong ones,
+ * the last one drops the weak edges left.
+ *
+ * @brief ImageProcessor::computeCanny
+ * @param stage
+ * @param pass
+ */
+void ImageProcessor::computeCanny(const FilterStage& stage, int pass) {
+    if(pass < 2) {
+        FilterStage smoothing(GAUSSIAN_BLUR);
+        smoothing.kernelSize = CANNY_KERNEL_SIZE;
+        smoothing.deviation = CANNY_DEVIATION;
+        computeSeparableGaussianBlur(smoothing, pass == 0);
+    } else if(pass == 2) {
+        computeEdgeGradient(1, true, CANNY_GRADIENT_SCALE);
+    } else if(pass == 3) {
+        cnSuppressionShaderProgram->bind();
+        setUniform(cnSuppressionShaderProgram, cnSuppressionUniforms.xOffsetLocation, xOffset, cnSuppressionUniforms.xOffset);
+        setUniform(cnSuppressionShaderProgram, cnSuppressionUniforms.yOffsetLocation, yOffset, cnSuppressionUniforms.yOffset);
+    } else if(pass == 4) {
+        cnThresholdShaderProgram->bind();
+        setUniform(cnThresholdShaderProgram, cnThresholdUniforms.lowThresholdLocation, stage.lowThreshold, cnThresholdUniforms.lowThreshold);
+        setUniform(cnThresholdShaderProgram, cnThresholdUniforms.highThresholdLocation, stage.highThreshold, cnThresholdUniforms.highThreshold);
+    } else {
+        cnHysteresisShaderProgram->bind();
+        setUniform(cnHysteresisShaderProgram, cnHysteresisUniforms.xOffsetLocation, xOffset, cnHysteresisUniforms.xOffset);
+        setUniform(cnHysteresisShaderProgram, cnHysteresisUniforms.yOffsetLocation, yOffset, cnHysteresisUniforms.yOffset);
+        setUniform(cnHysteresisShaderProgram, cnHysteresisUniforms.lastPassLocation, pass == passCount(stage) - 1 ? 1 : 0, cnHysteresisUniforms.lastPass);
+    }
+}
+
+/**
+ * Calculates the radii of the boxes whose successive blurs approximate a gaussian blur.
+ * The widths are the two odd ones around the ideal width, mixed so that the variances of the boxes
+ * add up as close as possible to the variance of the gaussian.
+ * The boxes are limited to the biggest one.
+ *
+ * @brief ImageProcessor::calculateBoxRadii
+ * @param deviation the standard deviation of the gaussian
+ * @param radii the radius of each box
+ */
+void ImageProcessor::calculateBoxRadii(float deviation, int radii[BOX_GAUSSIAN_PASSES]) {
+    float variance = 12.0f * deviation * deviation;
+    int n = BOX_GAUSSIAN_PASSES;
+
+    // the ideal width of n boxes having the gaussian's variance, and the odd widths around it
+    int lower = (int)floor(sqrt(variance / n + 1.0f));
+    if(lower % 2 == 0) {
+        lower--;
+    }
+    int upper = lower + 2;
+
+    // the number of boxes of the lower width
+    int lowerCount = qRound((variance - n*lower*lower - 4*n*lower - 3*n) / (-4.0f*lower - 4.0f));
+    lowerCount = qBound(0, lowerCount, n);
+    for(int i = 0; i < n; i++) {
+        radii[i] = qMin(i < lowerCount ? lower : upper, MAX_BOX_KERNEL_SIZE) / 2;
+    }
+}
+
+/**
+ * Calculates the 3x3 kernel of the edge detection.
+ * LoG is a single kernel, Sobel and Prewitt are given by their x kernel:
+ * their y kernel is minus its transpose, it goes from the bottom to the top.
+ *
+ * @brief ImageProcessor::calculateEdgeKernel
+ * @param kernel
+ * @param algorithm
+ */
+void ImageProcessor::calculateEdgeKernel(float kernel[], int algorithm) {
+
+    // if this is the laplacian
+    if(algorithm == 0) {
+
+        // laplacian of the gaussian kernel
+        kernel[0] = kernel[2] = kernel[6] = kernel[8] = 0.0;
+        kernel[1] = kernel[3] = kernel[5] = kernel[7] = 1.0;
+        kernel[4] = -4.0;
+
+    }
+
+    // the x kernel of a gradient algorithm
+    else {
+        switch(algorithm) {
+        case 1: // sobel x kernel
+            kernel[0] = kernel[6] = -1.0;
+            kernel[1] = kernel[4] = kernel[7] = 0.0;
+            kernel[2] = kernel[8] = 1.0;
+            kernel[3] = -2.0;
+            kernel[5] = 2.0;
+            break;
+        case 2: // prewitt x kernel
+            kernel[0] = kernel[3] = kernel[6] = -1.0;
+            kernel[1] = kernel[4] = kernel[7] = 0.0;
+            kernel[2] = kernel[5] = kernel[8] = 1.0;
+            break;
+        }
+    }
+}
@@ -0,0 +1,422 @@
+#ifndef IMAGEPROCESSOR_H
+#define IMAGEPROCESSOR_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <cmath>
+#include "filterstage.h"
+#include "passtimer.h"
+#include "programcache.h"
+
+/**
+ * A frame buffer object and the texture it renders into.
+ */
+struct RenderTarget {
+    GLuint fboID;
+    GLuint textureID;
+};
+
+/**
+ * The 3D textures of the bilateral grid and the frame buffer object rendering into their layers.
+ * The grid is splatted into the first texture, the blur goes back and forth between both.
+ */
+struct BilateralGrid {
+    GLuint fboID;
+    GLuint textureIDs[2];
+    int width;
+    int height;
+    int depth;
+};
+
+/**
+ * A pixel buffer object the result of a render is read back into,
+ * and the fence telling when the gpu has filled it.
+ * Without pixel buffer objects, the result is read back at once into the image.
+ */
+struct Readback {
+    GLuint bufferID;
+    GLsync fence;
+    int width;
+    int height;
+    bool deep;
+    QImage image;
+};
+
+/**
+ * The uniforms' locations of a shader program, resolved once after linking,
+ * and the values last uploaded to them.
+ * A location is -1 when the shader does not declare the uniform.
+ */
+struct ShaderUniforms {
+    int kernelSizeLocation;
+    int xOffsetLocation;
+    int yOffsetLocation;
+    int rangeLocation;
+    int scaleFactorLocation;
+    int kernelValueLocation;
+    int cellSizeLocation;
+    int layerLocation;
+    int axisLocation;
+    int orientationLocation;
+    int lowThresholdLocation;
+    int highThresholdLocation;
+    int lastPassLocation;
+    int firstPassLocation;
+    int strideLocation;
+    int cellWidthLocation;
+    int cellHeightLocation;
+    int cellApronLocation;
+    int imageWidthLocation;
+    int imageHeightLocation;
+
+    int kernelSize;
+    float xOffset;
+    float yOffset;
+    float range;
+    float scaleFactor;
+    QVector<float> kernelValue;
+    int cellSize;
+    int layer;
+    int axis;
+    int orientation;
+    float lowThreshold;
+    float highThreshold;
+    int lastPass;
+    int firstPass;
+    int stride;
+    int cellWidth;
+    int cellHeight;
+    int cellApron;
+    int imageWidth;
+    int imageHeight;
+};
+
+/**
+ * A shader program specialized for a kernel size, and its uniforms.
+ * The program is NULL when the specialized source does not link.
+ */
+struct ShaderVariant {
+    QOpenGLShaderProgram* program;
+    ShaderUniforms uniforms;
+};
+
+/**
+ * Runs the filter pipeline with opengl.
+ * Does not own any surface: it works in whatever context is current,
+ * the widget's one for the GUI or an offscreen one for the batch mode.
+ */
+class ImageProcessor : protected QOpenGLFunctions
+{
+public:
+    // the precision of the processing: the gamma encoded values in 8 bits, as they are stored,
+    // or the linear light values in half floats, decoded from srgb and encoded back by a last pass.
+    // A 16 bits image is read back in 16 bits in both, but only the half floats keep its depth through the passes
+    enum Precision {
+        GAMMA_8BIT,
+        LINEAR_FLOAT16
+    };
+
+private:
+    float xOffset;
+    float yOffset;
+    int imageWidth;
+    int imageHeight;
+    GLuint imageTextureID;
+
+    // an image with 16 bits per channel is uploaded as it is, in linear precision it is decoded into linearImage
+    // since only the 8 bits textures can be decoded from srgb by the sampler
+    Precision precision;
+    bool imageDeep;
+    RenderTarget linearImage;
+    GLuint getImageSourceTextureID() const;
+    GLenum getTargetFormat() const;
+    int getTargetBytesPerPixel() const;
+    static QImage::Format readbackFormat(bool deep);
+
+    // the functions of opengl 3.3 which are not in QOpenGLFunctions, NULL when they are not available
+    QOpenGLFunctions_3_3_Core* gl33;
+
+    // the functions of opengl 4.3, NULL when they are not available; the compute shaders need them
+    QOpenGLFunctions_4_3_Core* gl43;
+
+    // the image is copied into one pixel buffer object while the gpu may still be reading the other one
+    static const int UPLOAD_BUFFER_COUNT = 2;
+    GLuint uploadBufferIDs[UPLOAD_BUFFER_COUNT];
+    int nextUploadBuffer;
+    void uploadPixels(const uchar* pixels, int size, GLenum format, GLenum type);
+
+    // the results are read back into pixel buffer objects and only mapped once their fence is signaled
+    static const int READBACK_COUNT = 2;
+    Readback readbacks[READBACK_COUNT];
+    int firstReadback;
+    int pendingReadbackCount;
+    QImage takeReadback();
+
+    // the results taken early from their readback so that a later render can use it, oldest first
+    QList<QImage> finishedImages;
+
+    // ping-pong targets of the image's size, reused by every multi-passes algorithm
+    static const int RENDER_TARGET_COUNT = 2;
+    RenderTarget renderTargets[RENDER_TARGET_COUNT];
+    void createRenderTargets();
+    void releaseRenderTargets();
+    void bindRenderTarget(int index);
+    void createRenderTarget(RenderTarget& target, int width, int height, GLenum internalFormat = GL_RGBA);
+    void releaseRenderTarget(RenderTarget& target);
+
+    // while the parameters change, the pipeline can run on a mip level of the image:
+    // the image is downsampled once into mipSource, then the passes go back and forth between mipTargets
+    RenderTarget mipSource;
+    RenderTarget mipTargets[RENDER_TARGET_COUNT];
+    int mipLevel;
+    bool mipSourceValid;
+    void prepareMipLevel(int level);
+    void releaseMipTargets();
+
+    // the size, the mip level and the targets of the current render
+    int renderWidth;
+    int renderHeight;
+    int renderLevel;
+    RenderTarget* activeTargets;
+
+    // the target of the image's size the whole pipeline is rendered into when the result is read back
+    RenderTarget exportTarget;
+    int exportWidth;
+    int exportHeight;
+    bool exportDeep;
+
+    // the passes of the renders are measured by the gpu when needed
+    PassTimer passTimer;
+    bool timingEnabled;
+
+    // where the last pass of the current render goes
+    GLuint outputFboID;
+    int outputWidth;
+    int outputHeight;
+    void bindOutput();
+
+    // every program shares the same compiled vertex shader, and is loaded from the cache when it can be
+    QByteArray vertexSource;
+    QOpenGLShader* vertexShader;
+    ProgramCache programCache;
+    QOpenGLShaderProgram* createProgram(const QString& fragmentFile, const QByteArray& defines = QByteArray());
+
+    QOpenGLShaderProgram* shaderProgram;
+    QOpenGLShaderProgram* srgbDecodeProgram;
+    QOpenGLShaderProgram* srgbEncodeProgram;
+
+    QOpenGLShaderProgram* gbShaderProgram;
+    ShaderUniforms gbUniforms;
+    QOpenGLShaderProgram* gbsShaderProgram;
+    ShaderUniforms gbsUniforms;
+    void computeGaussianBlur(const FilterStage& stage);
+    void computeSeparableGaussianBlur(const FilterStage& stage, bool horizontal);
+
+    QOpenGLShaderProgram* bfShaderProgram;
+    ShaderUniforms bfUniforms;
+    void computeBilateralFilter(const FilterStage& stage);
+
+    // the 2D gaussian blur and the bilateral filter have a program per kernel size, compiled on first use,
+    // in which the size is a constant and the loops unroll; the generic programs are used when one does not link
+    QMap<QPair<int, int>, ShaderVariant> shaderVariants;
+    ShaderVariant* getShaderVariant(FilterType type, int kernelSize);
+
+    // the 2D gaussian blur, the bilateral filter and the sharpening also have compute shaders: each work group
+    // loads its tile and the kernel's apron into shared memory once, rather than fetching every texel once per tap;
+    // they are compiled on first use per kernel size, for the format of the targets, and only run at the image's size
+    static const int COMPUTE_TILE_SIZE = 16;
+    bool computeEnabled;
+    QMap<QPair<int, int>, ShaderVariant> computeVariants;
+    ShaderVariant* getComputeVariant(FilterType type, int kernelSize);
+    ShaderVariant* getComputeStage(const FilterStage& stage);
+    void releaseComputeVariants();
+    void dispatchStage(const FilterStage& stage, ShaderVariant* variant, GLuint sourceTextureID, GLuint targetTextureID);
+
+    // the fast approximation of the bilateral filter: splatting the image into a grid, blurring it and slicing it
+    BilateralGrid bilateralGrid;
+    void createBilateralGrid(int width, int height, int depth);
+    void releaseBilateralGrid();
+    QOpenGLShaderProgram* bgSplatShaderProgram;
+    ShaderUniforms bgSplatUniforms;
+    QOpenGLShaderProgram* bgBlurShaderProgram;
+    ShaderUniforms bgBlurUniforms;
+    QOpenGLShaderProgram* bgSliceShaderProgram;
+    ShaderUniforms bgSliceUniforms;
+    void computeBilateralGrid(const FilterStage& stage, GLuint sourceTextureID);
+
+    // the box blurs read a summed-area table of the previous result, built by passes adding SAT_RADIX texels
+    // of the previous one along x then y; its 32 bits integer sums wrap around but the boxes' sums stay exact,
+    // so that a box of any size costs 4 fetches per pixel
+    static const int SAT_RADIX = 4;
+    RenderTarget satTargets[2];
+    int satWidth;
+    int satHeight;
+    QOpenGLShaderProgram* satScanShaderProgram;
+    ShaderUniforms satScanUniforms;
+    QOpenGLShaderProgram* satBoxShaderProgram;
+    ShaderUniforms satBoxUniforms;
+    void computeBoxBlur(int radius, GLuint sourceTextureID);
+    void setCellUniforms(QOpenGLShaderProgram* program, ShaderUniforms& uniforms);
+    void releaseSummedAreaTable();
+    static int satScanPassCount(int width, int height);
+
+    QVector<float> shKernel;
+    QOpenGLShaderProgram* shShaderProgram;
+    ShaderUniforms shUniforms;
+    void computeSharpening(const FilterStage& stage);
+
+    // the kernels of LoG, and the x kernels of Sobel and Prewitt
+    static const int EDGE_ALGORITHM_COUNT = 3;
+    QVector<float> edKernels[EDGE_ALGORITHM_COUNT];
+    QOpenGLShaderProgram* edShaderProgram;
+    ShaderUniforms edUniforms;
+    void computeEdgeDetection();
+
+    // Sobel and Prewitt compute both gradients and their magnitude in one pass
+    QOpenGLShaderProgram* egShaderProgram;
+    ShaderUniforms egUniforms;
+    void computeEdgeGradient(int algorithm, bool orientation, float scale);
+
+    // Canny smoothes the image, takes its gradient, thins it, thresholds it,
+    // then grows the strong edges into the weak ones a pixel per pass
+    QOpenGLShaderProgram* cnSuppressionShaderProgram;
+    ShaderUniforms cnSuppressionUniforms;
+    QOpenGLShaderProgram* cnThresholdShaderProgram;
+    ShaderUniforms cnThresholdUniforms;
+    QOpenGLShaderProgram* cnHysteresisShaderProgram;
+    ShaderUniforms cnHysteresisUniforms;
+    void computeCanny(const FilterStage& stage, int pass);
+
+    // the gaussian kernels already calculated, by size and deviation
+    static const int KERNEL_CACHE_SIZE = 64;
+    QMap<QPair<int, float>, QVector<float> > kernelCache;
+    QMap<QPair<int, float>, QVector<float> > kernel1DCache;
+    const QVector<float>& getKernel(int kernelSize, float deviation);
+    const QVector<float>& getKernel1D(int kernelSize, float deviation);
+
+    // the uniforms are only uploaded when their value changes
+    void resolveUniforms(QOpenGLShaderProgram* program, ShaderUniforms& uniforms);
+    void setUniform(QOpenGLShaderProgram* program, int location, int value, int& uploadedValue);
+    void setUniform(QOpenGLShaderProgram* program, int location, float value, float& uploadedValue);
+    void setUniform(QOpenGLShaderProgram* program, int location, const QVector<float>& value, QVector<float>& uploadedValue);
+
+    // the textures' rows go from the top of the image to its bottom, as in the QImage,
+    // only the quad drawn onto the screen flips them since its rows go from bottom to top
+    QOpenGLVertexArrayObject* vao;
+    QOpenGLVertexArrayObject* screenVao;
+    QOpenGLBuffer* vboPosition;
+    QOpenGLBuffer* vboTexture;
+    QOpenGLBuffer* vboScreenTexture;
+    void createQuad();
+    void createShaders();
+
+    static void copyTile(const QImage& tile, const QRect& keptRect, const QRect& loadedRect, QImage& result);
+
+    // the small images of the same size are packed into the cells of an atlas, each with an apron of replicated edges;
+    // the aprons are replicated again from the previous result before the passes reading them, and the boxes stop at the cells
+    QSize atlasCellSize;
+    QSize atlasImageSize;
+    int atlasApron;
+    QOpenGLShaderProgram* atlasApronShaderProgram;
+    ShaderUniforms atlasApronUniforms;
+    static bool readsAprons(const FilterStage& stage, int pass);
+    void replicateAprons(GLuint sourceTextureID, int target);
+    static int pipelineAlignment(const QList<FilterStage>& pipeline);
+    static void atlasCell(const QSize& imageSize, const QList<FilterStage>& pipeline, int& apron, QSize& cellSize);
+    static void copyPadded(const QImage& image, int apron, const QRect& cellRect, QImage& atlas);
+
+    void drawQuad(bool onScreen = false);
+    void computeStage(const FilterStage& stage, int pass, GLuint sourceTextureID);
+
+public:
+    // the biggest kernel size handled by the 2D gaussian blur and bilateral filter shaders
+    static const int MAX_KERNEL_SIZE = 9;
+
+    // the biggest kernel size handled by the separable gaussian blur shader
+    static const int MAX_SEPARABLE_KERNEL_SIZE = 65;
+
+    // the size of the tiles when an image is processed in several parts
+    static const int DEFAULT_TILE_SIZE = 2048;
+
+    // the biggest width and height of an atlas packing small images
+    static const int ATLAS_SIZE = 4096;
+
+    // the edge detection algorithm going through several stages to find thin edges
+    static const int CANNY_ALGORITHM = 3;
+
+    // the gaussian blur algorithms reading a summed-area table: a box blur, and boxes approximating a gaussian
+    static const int BOX_ALGORITHM = 2;
+    static const int BOX_GAUSSIAN_ALGORITHM = 3;
+    static const int BOX_GAUSSIAN_PASSES = 3;
+
+    // the biggest box, whose sums of 8 bits values fit in 32 bits, and the integers a channel of 1.0 becomes
+    // in the tables; the linear precision keeps more bits, which leaves room for boxes of the same size
+    static const int MAX_BOX_KERNEL_SIZE = 511;
+    static const int SAT_GAMMA_SCALE = 255;
+    static const int SAT_LINEAR_SCALE = 16383;
+
+    // the smoothing of Canny, and the number of passes growing its strong edges
+    static const int CANNY_KERNEL_SIZE = 5;
+    static const float CANNY_DEVIATION;
+    static const float CANNY_GRADIENT_SCALE;
+    static const int CANNY_HYSTERESIS_PASSES = 8;
+
+    // the laplacian kernel of the sharpening
+    static const float SHARPENING_KERNEL[9];
+
+    // the kernels are shared with the cpu backend so that both compute the same thing
+    static int passCount(const FilterStage& stage);
+    static QString passName(const FilterStage& stage, int pass);
+    static void calculateKernel(float kernel[], int kernelSize, float deviation);
+    static void calculateKernel1D(float kernel[], int kernelSize, float deviation);
+    static void calculateEdgeKernel(float kernel[], int algorithm);
+    static void calculateBoxRadii(float deviation, int radii[BOX_GAUSSIAN_PASSES]);
+    static double computePSNR(const QImage& reference, const QImage& image);
+    static int gridCellSize(const FilterStage& stage);
+    static int stageRadius(const FilterStage& stage);
+    static int pipelineRadius(const QList<FilterStage>& pipeline);
+    static int mipLevelFor(int width, int height, int maxSize);
+    static bool isDeepImage(const QImage& image);
+    static QString precisionName(Precision precision);
+
+    ImageProcessor();
+    ~ImageProcessor();
+    void initialize();
+    void loadImage(const QImage& image);
+    int getImageWidth() const;
+    int getImageHeight() const;
+    int getMaxTextureSize();
+    qint64 getTextureMemory() const;
+    qint64 getFrameTraffic(const QList<FilterStage>& pipeline) const;
+    void setPrecision(Precision precision);
+    Precision getPrecision() const;
+    bool isComputeAvailable() const;
+    void setComputeEnabled(bool enabled);
+    bool isComputeEnabled() const;
+    void setTimingEnabled(bool enabled);
+    bool isTimingEnabled() const;
+    PassTimer& getPassTimer();
+    const ProgramCache& getProgramCache() const;
+
+    void render(const QList<FilterStage>& pipeline, GLuint fboID, int width, int height, int level = 0);
+    double measureBilateralGridPSNR(const FilterStage& stage);
+    QImage renderImage(const QList<FilterStage>& pipeline);
+    void startRender(const QList<FilterStage>& pipeline);
+    int getPendingRenderCount() const;
+    QImage takeRenderedImage();
+    QImage processTiled(const QImage& image, const QList<FilterStage>& pipeline, int tileSize = DEFAULT_TILE_SIZE);
+    int atlasCapacity(const QSize& imageSize, const QList<FilterStage>& pipeline);
+    QList<QImage> processAtlas(const QList<QImage>& images, const QList<FilterStage>& pipeline);
+};
+
+#endif // IMAGEPROCESSOR_H
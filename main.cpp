@@ -1,8 +1,21 @@
 #include "mainwindow.h"
+#include "batchprocessor.h"
+#include "streamprocessor.h"
 #include <QApplication>
+#include <QGuiApplication>
 
 int main(int argc, char *argv[])
 {
+    // the command line modes run without any window, the streaming one shares options with the batch one
+    if(StreamProcessor::isRequested(argc, argv)) {
+        QGuiApplication a(argc, argv);
+        return StreamProcessor().run(a.arguments());
+    }
+    if(BatchProcessor::isRequested(argc, argv)) {
+        QGuiApplication a(argc, argv);
+        return BatchProcessor().run(a.arguments());
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.resize(1000, 800);
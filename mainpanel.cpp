@@ -1,5 +1,12 @@
 #include "mainpanel.h"
 
+const int MainPanel::MAX_KERNEL_SIZE;
+const int MainPanel::MAX_SEPARABLE_KERNEL_SIZE;
+const int MainPanel::MAX_BOX_KERNEL_SIZE;
+const int MainPanel::TIMING_INTERVAL;
+const int MainPanel::INTERACTIVE_SIZE;
+const int MainPanel::SETTLE_DELAY;
+
 /**
  * Main component of the application. Is the opengl container which will manage the opengl context.
  *
@@ -9,41 +16,67 @@
 MainPanel::MainPanel(QWidget *parent) :
     QGLWidget(parent) {
 
-    // by default we only need one step
-    onePass = true;
-
-    // by default gaussian blur is disabled and the kernel size is 3
-    gbEnabled = false;
-    gbKernelSize = 3;
-    gbDeviation = 0.5;
-
-    // by default bilateral filter is disabled
-    bfEnabled = false;
-    bfKernelSize = 3;
-    bfDeviation = 0.5;
-    bfRange = 0.1;
-
-    // by default sharpening is disabled and the scale factor is 0
-    shEnabled = false;
-    shScaleFactor = 0;
+    // the opengl side is created along with the context
+    processor = NULL;
+    tiled = false;
+    fileIndex = -1;
+
+    // the timings are only read while they are shown
+    timingTimer = new QTimer(this);
+    timingTimer->setInterval(TIMING_INTERVAL);
+    connect(timingTimer, SIGNAL(timeout()), this, SLOT(collectTimings()));
+
+    // the full-size render waits for the parameters to settle
+    interacting = false;
+    settleTimer = new QTimer(this);
+    settleTimer->setSingleShot(true);
+    settleTimer->setInterval(SETTLE_DELAY);
+    connect(settleTimer, SIGNAL(timeout()), this, SLOT(refine()));
+
+    // one frame per refresh of the display, 60 Hz when it is unknown
+    dirty = false;
+    renderCount = 0;
+    skippedRenderCount = 0;
+    qreal refreshRate = QGuiApplication::primaryScreen() != NULL ? QGuiApplication::primaryScreen()->refreshRate() : 0.0;
+    frameInterval = qRound(1000.0 / (refreshRate > 0.0 ? refreshRate : 60.0));
+    frameTimer = new QTimer(this);
+    frameTimer->setSingleShot(true);
+    connect(frameTimer, SIGNAL(timeout()), this, SLOT(renderFrame()));
+
+    // by default every algorithm is disabled, so the pipeline is empty
+    // gaussian blur is separable and the kernel size is 3
+    settings[GAUSSIAN_BLUR] = FilterStage(GAUSSIAN_BLUR);
+
+    // bilateral filter's kernel size is 3
+    settings[BILATERAL_FILTER] = FilterStage(BILATERAL_FILTER);
+
+    // sharpening's scale factor is 0
+    settings[SHARPENING] = FilterStage(SHARPENING);
+
+    // edge detection's algorithm is the 0th
+    settings[EDGE_DETECTION] = FilterStage(EDGE_DETECTION);
+}
 
-    // by default edge detection is disabled and the algorithm used is the 0th
-    edEnabled = false;
-    edAlgorithm = 0;
+/**
+ * Releases the opengl side in the widget's context.
+ *
+ * @brief MainPanel::~MainPanel
+ */
+MainPanel::~MainPanel() {
+    makeCurrent();
+    delete processor;
 }
 
 /**
  * Callback for opengl context initialization.
  * Initializes opengl functions such as glClearColor and glViewport.
- * Creates the 3D object quad to display a texture.
- * Creates and links all the shaders that will be used in the application.
+ * Creates the processor, which creates the 3D object quad and all the shaders.
  *
  * @brief MainPanel::initializeGL
  */
 void MainPanel::initializeGL() {
     qDebug() << "OpenGL version: " << (char*)glGetString(GL_VERSION);
     qDebug() << "initializing GL";
-    initializeGLFunctions();
 
     // setting background color
     glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
@@ -51,160 +84,12 @@ void MainPanel::initializeGL() {
     // specifying window coords
     glViewport(0, 0, width(), height());
 
-    // creating 3D object to draw onto
-    createQuad();
-
-    // creating shaders
-    createShaders();
-}
-
-/**
- * Creates all the shaders for all the algorithms.
- * Compiles and links them.
- *
- * @brief MainPanel::createShaders
- */
-void MainPanel::createShaders() {
-
-    // creating the shader for the original image
-    shaderProgram = new QGLShaderProgram;
-
-    // the vertex shader
-    vertexShader = new QGLShader(QGLShader::Vertex);
-    vertexShader->compileSourceFile(":/shaders/vertex_shader.vsh");
-
-    // the fragment shader
-    fragmentShader = new QGLShader(QGLShader::Fragment);
-    fragmentShader->compileSourceFile(":/shaders/original.fsh");
-
-    // linking shaders in program
-    shaderProgram->addShader(vertexShader);
-    shaderProgram->addShader(fragmentShader);
-
-    shaderProgram->bindAttributeLocation("in_Position", 0);
-    shaderProgram->bindAttributeLocation("in_TexCoord", 1);
-    shaderProgram->link();
-
-    // creating the shader for gaussian blur algorithm
-    gbShaderProgram = new QGLShaderProgram;
-
-    // the vertex shader
-    gbVertexShader = new QGLShader(QGLShader::Vertex);
-    gbVertexShader->compileSourceFile(":/shaders/vertex_shader.vsh");
-
-    // the fragment shader
-    gbFragmentShader = new QGLShader(QGLShader::Fragment);
-    gbFragmentShader->compileSourceFile(":/shaders/gaussian_blur.fsh");
-
-    // linking shaders in program
-    gbShaderProgram->addShader(gbVertexShader);
-    gbShaderProgram->addShader(gbFragmentShader);
-    gbShaderProgram->link();
-
-    // creating the shader for bilateral filter algorithm
-    bfShaderProgram = new QGLShaderProgram;
-
-    // the vertex shader
-    bfVertexShader = new QGLShader(QGLShader::Vertex);
-    bfVertexShader->compileSourceFile(":/shaders/vertex_shader.vsh");
-
-    // the fragment shader
-    bfFragmentShader = new QGLShader(QGLShader::Fragment);
-    bfFragmentShader->compileSourceFile(":/shaders/bilateral_filter.fsh");
+    // creating the quad and the shaders
+    processor = new ImageProcessor;
+    processor->initialize();
 
-    // linking shaders in program
-    bfShaderProgram->addShader(bfVertexShader);
-    bfShaderProgram->addShader(bfFragmentShader);
-    bfShaderProgram->link();
-
-    // creating the shader for bilateral filter algorithm
-    shShaderProgram = new QGLShaderProgram;
-
-    // the vertex shader
-    shVertexShader = new QGLShader(QGLShader::Vertex);
-    shVertexShader->compileSourceFile(":/shaders/vertex_shader.vsh");
-
-    // the fragment shader
-    shFragmentShader = new QGLShader(QGLShader::Fragment);
-    shFragmentShader->compileSourceFile(":/shaders/sharpening.fsh");
-
-    // linking shaders in program
-    shShaderProgram->addShader(shVertexShader);
-    shShaderProgram->addShader(shFragmentShader);
-    shShaderProgram->link();
-
-    // creating the shader for edge detection algorithm
-    edShaderProgram = new QGLShaderProgram;
-
-    // the vertex shader
-    edVertexShader = new QGLShader(QGLShader::Vertex);
-    edVertexShader->compileSourceFile(":/shaders/vertex_shader.vsh");
-
-    // the fragment shader
-    edFragmentShader = new QGLShader(QGLShader::Fragment);
-    edFragmentShader->compileSourceFile(":/shaders/edge_detection.fsh");
-
-    // linking shaders in program
-    edShaderProgram->addShader(edVertexShader);
-    edShaderProgram->addShader(edFragmentShader);
-    edShaderProgram->link();
-}
-
-/**
- * Creates the 3D object that will host the texture.
- * Whether it is a plain image or a processed one.
- *
- * @brief MainPanel::createQuad
- */
-void MainPanel::createQuad() {
-
-    // vertices' position array of coords
-    float position[] = {1.0f, -1.0f, 0.0f,
-                        1.0f, 1.0f, 0.0f,
-                        -1.0f, 1.0f, 0.0f,
-                        -1.0f, 1.0f, 0.0f,
-                        -1.0f, -1.0f, 0.0f,
-                        1.0f, -1.0f, 0.0f
-                       };
-
-    // vertices' texture array of coords
-    float texture[] = {1.0f, 0.0f,
-                       1.0f, 1.0f,
-                       0.0f, 1.0f,
-                       0.0f, 1.0f,
-                       0.0f, 0.0f,
-                       1.0f, 0.0f
-                      };
-
-    // creating vertex array object
-    vao = new QOpenGLVertexArrayObject(this);
-    vao->create();
-    vao->bind();
-
-    // creating the position vertex buffer object
-    vboPosition = new QOpenGLBuffer;
-    vboPosition->setUsagePattern(QOpenGLBuffer::StaticDraw);
-    vboPosition->create();
-    vboPosition->bind();
-    vboPosition->allocate(position, 6*3*sizeof(float));
-
-    // giving the position vbo the index 0
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, 0);
-
-    // creating the position vertex buffer object
-    vboTexture = new QOpenGLBuffer;
-    vboTexture->setUsagePattern(QOpenGLBuffer::StaticDraw);
-    vboTexture->create();
-    vboTexture->bind();
-    vboTexture->allocate(texture, 6*2*sizeof(float));
-
-    // giving the texture vbo the index 1
-    glVertexAttribPointer(1, 2, GL_FLOAT, false, 0, 0);
-
-    // releasing the objects
-    vao->release();
-    vboPosition->release();
-    vboTexture->release();
+    // the images too big for a texture are decoded at the size of a tile
+    decoder.setPreviewSize(processor->getMaxTextureSize(), ImageProcessor::DEFAULT_TILE_SIZE);
 }
 
 /**
@@ -224,372 +109,372 @@ void MainPanel::resizeGL(int w, int h) {
 
 /**
  * Loads the image with the specified path.
- * Binds it as a texture.
+ * The other images of its directory can then be shown with loadNextImage and loadPreviousImage.
  *
  * @brief MainPanel::loadImage
  * @param fileName
  */
 void MainPanel::loadImage(QString fileName) {
 
-    // getting the image by its path
-    QImageReader reader(fileName);
-    QImage image;
-    reader.read(&image);
-    image = convertToGLFormat(image);
-    resize(image.width(), image.height());
-    xOffset = 1.0 / image.width();
-    yOffset = 1.0 / image.height();
+    // listing the images next to it, the previous ones are kept when it cannot be read
+    QFileInfo info(fileName);
+    QStringList previousFiles = directoryFiles;
+    directoryFiles = ImageDecoder::listImages(info.absolutePath());
+    int index = directoryFiles.indexOf(info.absoluteDir().filePath(info.fileName()));
+    if(index < 0) {
+        directoryFiles = QStringList() << fileName;
+        index = 0;
+    }
+    if(!showImage(index)) {
+        directoryFiles = previousFiles;
+    }
+}
 
-    // getting context focus
-    makeCurrent();
+/**
+ * Shows the next image of the directory.
+ *
+ * @brief MainPanel::loadNextImage
+ * @return false when there is no next image
+ */
+bool MainPanel::loadNextImage() {
+    return fileIndex + 1 < directoryFiles.size() && showImage(fileIndex + 1);
+}
+
+/**
+ * Shows the previous image of the directory.
+ *
+ * @brief MainPanel::loadPreviousImage
+ * @return false when there is no previous image
+ */
+bool MainPanel::loadPreviousImage() {
+    return fileIndex > 0 && showImage(fileIndex - 1);
+}
 
-    // creating the texture
-    glGenTextures(1, &textureID[0]);
+/**
+ * Shows an image of the directory.
+ * Binds it as a texture.
+ * Prefetches the following images and the previous one.
+ * An image bigger than the biggest texture is decoded scaled down,
+ * it is processed in tiles at its own size when it is saved.
+ *
+ * @brief MainPanel::showImage
+ * @param index
+ * @return false when the image cannot be read
+ */
+bool MainPanel::showImage(int index) {
 
-    // binding the texture
-    glBindTexture(GL_TEXTURE_2D, textureID[0]);
+    // getting the image by its path, it is usually already decoded
+    DecodedImage decoded = decoder.take(directoryFiles[index]);
 
-    // loading the buffer into the gpu texture and parameterizing it
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    // decoding the next ones meanwhile, and the previous one to go back
+    QStringList prefetchedFiles = directoryFiles.mid(index, decoder.getPrefetchCount() - 1);
+    if(index > 0) {
+        prefetchedFiles << directoryFiles[index - 1];
+    }
+    decoder.prefetch(prefetchedFiles);
 
-    // unbinding texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // the displayed image and its index are kept when it cannot be read
+    if(decoded.image.isNull()) {
+        qWarning() << "cannot read" << directoryFiles[index] << ":" << decoded.error;
+        return false;
+    }
+    fileIndex = index;
+
+    // getting context focus
+    makeCurrent();
+
+    // loading it into the gpu
+    int maxTextureSize = processor->getMaxTextureSize();
+    tiled = decoded.originalSize.width() > maxTextureSize || decoded.originalSize.height() > maxTextureSize;
+    previewImage = decoded.image;
+    loadPreview();
+    updateGL();
+    return true;
+}
+
+/**
+ * Loads what is displayed into the gpu: the image itself,
+ * or a copy scaled down to the size of a tile when it is too big.
+ *
+ * @brief MainPanel::loadPreview
+ */
+void MainPanel::loadPreview() {
+    resize(previewImage.width(), previewImage.height());
+    processor->loadImage(previewImage);
 }
 
 /**
  * Callback for the opengl context loop cycle.
  * Clears the screen.
- * Uses the right shader program.
- * Draws the quad and binds the texture to it.
+ * Runs the pipeline, its last pass draws onto the screen.
  *
  * @brief MainPanel::paintGL
  */
 void MainPanel::paintGL() {
-    // qDebug() << "paintGL";
+
+    // whatever asked for this frame, the changes made until now are in it
+    dirty = false;
+    renderCount++;
+    lastFrameTime.start();
 
     // clearing the gl widget background
     glClear(GL_COLOR_BUFFER_BIT);
 
-    // if there is only one step, using directly the texture
-    if(onePass) {
-        onePassPaint();
-    }
-
-    // if there are 2 steps, using the fbo
-    else {
-        twoPassesPaint();
+    // running all the stages, on a mip level while the parameters change
+    int level = 0;
+    if(interacting) {
+        level = ImageProcessor::mipLevelFor(processor->getImageWidth(), processor->getImageHeight(), INTERACTIVE_SIZE);
     }
+    processor->render(pipeline, 0, width(), height(), level);
 }
 
 /**
- * When there is only one pass necessary.
- * Will bind texture.
- * Will compute the right algorithm
- * Will enable the vao.
- * Will draw.
- * Will release everything that has been used.
- * @brief MainPanel::onePassPaint
+ * Renders the image at its own size once the parameters have settled.
+ *
+ * @brief MainPanel::refine
  */
-void MainPanel::onePassPaint() {
-
-    // binding the texture
-    glBindTexture(GL_TEXTURE_2D, textureID[0]);
+void MainPanel::refine() {
+    interacting = false;
+    scheduleRender();
+}
 
-    // choosing the right shader
-    if(gbEnabled) { // gaussian blur
-        computeGaussianBlur();
-    } else if(bfEnabled) { // bilateral filter
-        computeBilateralFilter();
-    } else if(shEnabled) { // sharpening
-        computeSharpening();
-    } else if(edEnabled) { // edge detection
-        computeEdgeDetection(true);
-    } else { // original image
-        shaderProgram->bind();
+/**
+ * Marks the frame dirty and schedules its render when the next refresh of the display is due.
+ * While it is dirty, the changes are batched into the scheduled frame and the render they would
+ * have cost is counted as skipped.
+ *
+ * @brief MainPanel::scheduleRender
+ */
+void MainPanel::scheduleRender() {
+    if(dirty) {
+        skippedRenderCount++;
+        return;
     }
+    dirty = true;
 
-    // enabling the vao
-    vao->bind();
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    // drawing the quad and disposing the vao
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-
-    // releasing the vao
-    vao->release();
-
-    // unbinding the texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // rendering right away when the last frame is older than a refresh
+    int elapsed = lastFrameTime.isValid() ? (int)lastFrameTime.elapsed() : frameInterval;
+    frameTimer->start(qMax(0, frameInterval - elapsed));
 }
 
-void MainPanel::twoPassesPaint() {
-
-    // 1st pass
-    // activing the texture and binding it
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureID[0]);
-
-    // creating the frame buffer object
-    glGenFramebuffers(1, &fboID);
-
-    // creating the fbo's texture and activing it
-    glGenTextures(1, &textureID[1]);
-    glActiveTexture(GL_TEXTURE0 + 1);
-
-    // binding the fbo
-    glBindFramebuffer(GL_FRAMEBUFFER, fboID);
-
-    // loading the texture into the fbo
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureID[1], 0);
-
-    // choosing the right shader
-    if(edEnabled) { // edge detection
-        computeEdgeDetection(true);
+/**
+ * Renders the scheduled frame, unless something else has rendered it meanwhile.
+ *
+ * @brief MainPanel::renderFrame
+ */
+void MainPanel::renderFrame() {
+    if(dirty) {
+        updateGL();
     }
+}
 
-    // enabling the vao
-    vao->bind();
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    // drawing the quad in the fbo and disposing the vbos
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // unbinding the texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+/**
+ * @brief MainPanel::getRenderCount
+ * @return the number of frames rendered onto the screen
+ */
+int MainPanel::getRenderCount() const {
+    return renderCount;
+}
 
-    // 2nd pass
-    // binding the texture
-    glBindTexture(GL_TEXTURE_2D, textureID[1]);
+/**
+ * @brief MainPanel::getSkippedRenderCount
+ * @return the number of changes batched into an already scheduled frame, which did not cost a render
+ */
+int MainPanel::getSkippedRenderCount() const {
+    return skippedRenderCount;
+}
 
-    // choosing the right shader
-    if(edEnabled) { // edge detection
-        computeEdgeDetection(false);
+/**
+ * Renders the pipeline at the image's own size, whatever the size of the widget.
+ * Saves the result to the specified path.
+ * An image too big to be loaded at once is processed in tiles.
+ *
+ * @brief MainPanel::saveImage
+ * @param fileName
+ * @return false when no image is loaded or when it cannot be written
+ */
+bool MainPanel::saveImage(QString fileName) {
+    if(fileIndex < 0) {
+        qWarning("no image to save");
+        return false;
     }
 
-    // drawing the quad and disposing the vao
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
+    // getting context focus
+    makeCurrent();
 
-    // releasing the vao
-    vao->release();
+    // rendering into a dedicated frame buffer object, not the widget's one
+    if(!tiled) {
+        QImage image = processor->renderImage(pipeline);
+        return image.save(fileName);
+    }
 
-    // unbinding texture and fbo
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    // the tiles replace the displayed image in the gpu
+    DecodedImage decoded = ImageDecoder::decode(directoryFiles[fileIndex]);
+    QImage image = processor->processTiled(decoded.image, pipeline);
+    bool saved = image.save(fileName);
+    loadPreview();
+    updateGL();
+    return saved;
 }
 
 /**
- * Uses the shader for the gaussian blur algorithm.
- * Calculates the kernel.
- * Gets the kernel size uniform's location and sets the current value to it.
+ * Starts or stops measuring the passes of the pipeline.
+ * While they are measured, their timings are regularly sent with timingsChanged.
  *
- * @brief MainPanel::computeGaussianBlur
+ * @brief MainPanel::setTimingEnabled
+ * @param enabled
  */
-void MainPanel::computeGaussianBlur() {
-
-    // creating the kernel values array
-    float kernel[gbKernelSize*gbKernelSize];
-
-    // calculating it
-    calculateKernel(kernel, gbKernelSize, gbDeviation);
-
-    // using the gaussian blur shader program
-    gbShaderProgram->bind();
-
-    // getting all the uniforms' location
-    int kernelSizeLocation = gbShaderProgram->uniformLocation("kernel_size");
-    int xOffsetLocation = gbShaderProgram->uniformLocation("x_offset");
-    int yOffsetLocation = gbShaderProgram->uniformLocation("y_offset");
-    int kernelValueLocation = gbShaderProgram->uniformLocation("kernel_value");
-
-    // setting all the uniforms' value
-    gbShaderProgram->setUniformValue(kernelSizeLocation, gbKernelSize);
-    gbShaderProgram->setUniformValue(xOffsetLocation, xOffset);
-    gbShaderProgram->setUniformValue(yOffsetLocation, yOffset);
-    gbShaderProgram->setUniformValueArray(kernelValueLocation, kernel, gbKernelSize*gbKernelSize, 1);
+void MainPanel::setTimingEnabled(bool enabled) {
+    if(processor == NULL) {
+        return;
+    }
+    processor->setTimingEnabled(enabled);
+    if(enabled) {
+        timingTimer->start();
+    } else {
+        timingTimer->stop();
+    }
+    scheduleRender();
 }
 
 /**
- * Calculates the kernel.
- * @brief MainPanel::calculateKernel
- * @param kernel
- * @param kernelSize
- * @param deviation
+ * Chooses the precision of the passes, the image is loaded again in the new one.
+ *
+ * @brief MainPanel::setLinearPrecision
+ * @param linear true for linear light in half floats, false for the 8 bits gamma encoded values
  */
-void MainPanel::calculateKernel(float kernel[], int kernelSize, float deviation) {
-
-    // the sum of all the kernel values
-    float sum = 0.0;
-
-    // loops going from the upper left corner to the bottom right corner
-    int index = 0;
-    for(int y = kernelSize/2; y >= -kernelSize/2; y--) {
-        for(int x = -kernelSize/2; x <= kernelSize/2; x++) {
-
-            // calculating the value of the kernel in (x, y)
-            kernel[index] = (1.0 / (2.0*M_PI*deviation*deviation)) * exp(- ((x*x) + (y*y)) / (2*deviation*deviation));
-
-            // updating the sum
-            sum += kernel[index];
-            index++;
-        }
+void MainPanel::setLinearPrecision(bool linear) {
+    if(processor == NULL) {
+        return;
     }
-
-    // normalizing the values in the kernel
-    for(int i = 0; i < kernelSize*kernelSize; i++) {
-        kernel[i] /= sum;
+    makeCurrent();
+    processor->setPrecision(linear ? ImageProcessor::LINEAR_FLOAT16 : ImageProcessor::GAMMA_8BIT);
+    if(!previewImage.isNull()) {
+        loadPreview();
     }
-
+    scheduleRender();
 }
 
 /**
- * Uses the shader for the bilateral filter algorithm.
- * Gets the kernel size and delta uniforms' location and sets the current values to them.
+ * Reads the timings the gpu is done with and sends them.
  *
- * @brief MainPanel::computeBilateralFilter
+ * @brief MainPanel::collectTimings
  */
-void MainPanel::computeBilateralFilter() {
-
-    // creating the kernel values array
-    float kernel[bfKernelSize*bfKernelSize];
-
-    // calculating it
-    calculateKernel(kernel, bfKernelSize, bfDeviation);
-
-    // using the gaussian blur shader program
-    bfShaderProgram->bind();
-
-    // getting all the uniforms' location
-    int kernelSizeLocation = bfShaderProgram->uniformLocation("kernel_size");
-    int xOffsetLocation = bfShaderProgram->uniformLocation("x_offset");
-    int yOffsetLocation = bfShaderProgram->uniformLocation("y_offset");
-    int rangeLocation = bfShaderProgram->uniformLocation("range");
-    int kernelValueLocation = bfShaderProgram->uniformLocation("kernel_value");
-
-    // setting all the uniforms' value
-    bfShaderProgram->setUniformValue(kernelSizeLocation, bfKernelSize);
-    bfShaderProgram->setUniformValue(xOffsetLocation, xOffset);
-    bfShaderProgram->setUniformValue(yOffsetLocation, yOffset);
-    bfShaderProgram->setUniformValue(rangeLocation, bfRange);
-    bfShaderProgram->setUniformValueArray(kernelValueLocation, kernel, bfKernelSize*bfKernelSize, 1);
+void MainPanel::collectTimings() {
+    makeCurrent();
+    processor->getPassTimer().collect();
+    emit timingsChanged(QString("%1 | renders: %2, skipped: %3").arg(processor->getPassTimer().getSummary())
+                        .arg(renderCount).arg(skippedRenderCount));
 }
 
 /**
- * Uses the shader for the sharpening algorithm.
- * Gets the scale factor uniform's location and sets the current value to it.
+ * Describes the timings of the passes along with what has been measured:
+ * the pipeline, the size of the image and the driver.
  *
- * @brief MainPanel::computeSharpening
+ * @brief MainPanel::getTimingReport
+ * @return the json object
  */
-void MainPanel::computeSharpening() {
-
-    // using the sharpening shader program
-    shShaderProgram->bind();
-
-    // getting all the uniforms' location
-    int xOffsetLocation = shShaderProgram->uniformLocation("x_offset");
-    int yOffsetLocation = shShaderProgram->uniformLocation("y_offset");
-    int scaleFactorLocation = shShaderProgram->uniformLocation("scale_factor");
-    int kernelValueLocation = shShaderProgram->uniformLocation("kernel_value");
-
-    // setting all the uniforms' value
-    shShaderProgram->setUniformValue(xOffsetLocation, xOffset);
-    shShaderProgram->setUniformValue(yOffsetLocation, yOffset);
-    shShaderProgram->setUniformValue(scaleFactorLocation, shScaleFactor);
-    shShaderProgram->setUniformValueArray(kernelValueLocation, shKernel, 9, 1);
-
+QJsonObject MainPanel::getTimingReport() {
+    makeCurrent();
+    processor->getPassTimer().collect();
+    QJsonObject report = processor->getPassTimer().toJson();
+    report["pipeline"] = getPipelineDescription();
+    report["width"] = processor->getImageWidth();
+    report["height"] = processor->getImageHeight();
+    report["renders"] = renderCount;
+    report["skippedRenders"] = skippedRenderCount;
+    return report;
 }
 
 /**
- * Uses the shader for the edge detection algorithm.
- * Chooses between several algorithms.
+ * Gets the ordered stages of the pipeline.
  *
- * @brief MainPanel::computeEdgeDetection
+ * @brief MainPanel::getPipeline
+ * @return the stages
  */
-void MainPanel::computeEdgeDetection(bool firstPass) {
+const QList<FilterStage>& MainPanel::getPipeline() const {
+    return pipeline;
+}
 
-    // if this is for a one-pass algorithm
-    if(onePass) {
+/**
+ * Replaces the whole pipeline, the stages will run in the given order.
+ *
+ * @brief MainPanel::setPipeline
+ * @param stages
+ */
+void MainPanel::setPipeline(const QList<FilterStage>& stages) {
+    pipeline = stages;
+    scheduleRender();
+}
 
-        // laplacian of the gaussian kernel
-        edKernel[0] = edKernel[2] = edKernel[6] = edKernel[8] = 0.0;
-        edKernel[1] = edKernel[3] = edKernel[5] = edKernel[7] = 1.0;
-        edKernel[4] = -4.0;
+/**
+ * Gets a readable description of the pipeline, such as "Bilateral Filter > Sharpening".
+ *
+ * @brief MainPanel::getPipelineDescription
+ * @return the description
+ */
+QString MainPanel::getPipelineDescription() const {
+    static const char* names[FILTER_TYPE_COUNT] = { "Gaussian Blur", "Bilateral Filter", "Sharpening", "Edge Detection" };
 
+    QStringList stageNames;
+    for(const FilterStage& stage : pipeline) {
+        stageNames << names[stage.type];
     }
+    return stageNames.isEmpty() ? QString("Original") : stageNames.join(" > ");
+}
 
-    // if this is for a two-passes algorithm
-    else {
-
-        // if this is the first pass, going through x
-        if(firstPass) {
-            switch(edAlgorithm) {
-            case 1: // sobel x kernel
-                edKernel[0] = edKernel[6] = -1.0;
-                edKernel[1] = edKernel[4] = edKernel[7] = 0.0;
-                edKernel[2] = edKernel[8] = 1.0;
-                edKernel[3] = -2.0;
-                edKernel[5] = 2.0;
-                break;
-            case 2: // prewitt x kernel
-                edKernel[0] = edKernel[3] = edKernel[6] = -1.0;
-                edKernel[1] = edKernel[4] = edKernel[7] = 0.0;
-                edKernel[2] = edKernel[5] = edKernel[8] = 1.0;
-                break;
-            }
-        }
+/**
+ * Enables or disables the stage of an algorithm.
+ * An enabled stage is appended at the end of the pipeline with the parameters of the GUI.
+ *
+ * @brief MainPanel::enableStage
+ * @param type
+ * @param enabled
+ */
+void MainPanel::enableStage(FilterType type, bool enabled) {
 
-        // going through y
-        else {
-            switch(edAlgorithm) {
-            case 1: // sobel y kernel
-                edKernel[0] = edKernel[2] = 1.0;
-                edKernel[3] = edKernel[4] = edKernel[5] = 0.0;
-                edKernel[6] = edKernel[8] = -1.0;
-                edKernel[7] = -2.0;
-                edKernel[1] = 2.0;
-                break;
-            case 2: // prewitt y kernel
-                edKernel[0] = edKernel[1] = edKernel[2] = 1.0;
-                edKernel[3] = edKernel[4] = edKernel[5] = 0.0;
-                edKernel[6] = edKernel[7] = edKernel[8] = -1.0;
-                break;
-            }
+    // removing the stage wherever it is
+    for(int i = pipeline.size() - 1; i >= 0; i--) {
+        if(pipeline[i].type == type) {
+            pipeline.removeAt(i);
         }
     }
 
-    // using the edge detection shader program
-    edShaderProgram->bind();
-
-    // getting all the uniforms' location
-    int xOffsetLocation = edShaderProgram->uniformLocation("x_offset");
-    int yOffsetLocation = edShaderProgram->uniformLocation("y_offset");
-    int kernelValueLocation = edShaderProgram->uniformLocation("kernel_value");
-
-    // setting all the uniforms' value
-    edShaderProgram->setUniformValue(xOffsetLocation, xOffset);
-    edShaderProgram->setUniformValue(yOffsetLocation, yOffset);
-    edShaderProgram->setUniformValueArray(kernelValueLocation, edKernel, 9, 1);
+    // and putting it at the end if needed
+    if(enabled) {
+        pipeline.append(settings[type]);
+    }
+    scheduleRender();
 }
 
 /**
- * Gets the frame buffer.
- * Saves the current image to the specified path.
+ * Copies the parameters of the GUI for an algorithm into its stages.
+ * Only redraws when a stage of the pipeline has actually changed,
+ * on a mip level when the image is big until the parameters settle.
  *
- * @brief MainPanel::saveImage
- * @param fileName
+ * @brief MainPanel::updateStage
+ * @param type
  */
-void MainPanel::saveImage(QString fileName) {
-    QImage image = grabFrameBuffer(true);
-    image.save(fileName);
+void MainPanel::updateStage(FilterType type) {
+    bool changed = false;
+    for(int i = 0; i < pipeline.size(); i++) {
+        if(pipeline[i].type == type && pipeline[i] != settings[type]) {
+            pipeline[i] = settings[type];
+            changed = true;
+        }
+    }
+
+    // a disabled algorithm or a value set twice does not need a new frame
+    if(!changed) {
+        return;
+    }
+
+    // a small image is rendered at its own size right away
+    if(processor != NULL && ImageProcessor::mipLevelFor(processor->getImageWidth(), processor->getImageHeight(), INTERACTIVE_SIZE) > 0) {
+        interacting = true;
+        settleTimer->start();
+    }
+    scheduleRender();
 }
 
 /**
@@ -599,9 +484,7 @@ void MainPanel::saveImage(QString fileName) {
  * @param enabled
  */
 void MainPanel::updateGB(bool enabled) {
-    gbEnabled = enabled;
-    onePass = true;
-    updateGL();
+    enableStage(GAUSSIAN_BLUR, enabled);
 }
 
 /**
@@ -611,8 +494,8 @@ void MainPanel::updateGB(bool enabled) {
  * @param kernelSize
  */
 void MainPanel::updateGB(int kernelSize) {
-    gbKernelSize = kernelSize;
-    updateGL();
+    settings[GAUSSIAN_BLUR].kernelSize = kernelSize;
+    updateStage(GAUSSIAN_BLUR);
 }
 
 /**
@@ -622,8 +505,20 @@ void MainPanel::updateGB(int kernelSize) {
  * @param deviation
  */
 void MainPanel::updateGB(float deviation) {
-    gbDeviation = deviation;
-    updateGL();
+    settings[GAUSSIAN_BLUR].deviation = deviation;
+    updateStage(GAUSSIAN_BLUR);
+}
+
+/**
+ * Updates the choice of the gaussian blur algorithm.
+ * 0 is the separable kernel, 1 is the 2D reference kernel.
+ *
+ * @brief MainPanel::updateAlgorithmGB
+ * @param algorithm
+ */
+void MainPanel::updateAlgorithmGB(int algorithm) {
+    settings[GAUSSIAN_BLUR].algorithm = algorithm;
+    updateStage(GAUSSIAN_BLUR);
 }
 
 /**
@@ -633,8 +528,7 @@ void MainPanel::updateGB(float deviation) {
  * @param b
  */
 void MainPanel::updateBF(bool enabled) {
-    bfEnabled = enabled;
-    updateGL();
+    enableStage(BILATERAL_FILTER, enabled);
 }
 
 /**
@@ -644,8 +538,8 @@ void MainPanel::updateBF(bool enabled) {
  * @param kernelSize
  */
 void MainPanel::updateBF(int kernelSize) {
-    bfKernelSize = kernelSize;
-    updateGL();
+    settings[BILATERAL_FILTER].kernelSize = kernelSize;
+    updateStage(BILATERAL_FILTER);
 }
 
 /**
@@ -655,8 +549,8 @@ void MainPanel::updateBF(int kernelSize) {
  * @param deviation
  */
 void MainPanel::updateDeviationBF(float deviation) {
-    bfDeviation = deviation;
-    updateGL();
+    settings[BILATERAL_FILTER].deviation = deviation;
+    updateStage(BILATERAL_FILTER);
 }
 
 /**
@@ -666,8 +560,36 @@ void MainPanel::updateDeviationBF(float deviation) {
  * @param deviation
  */
 void MainPanel::updateRangeBF(float range) {
-    bfRange = range;
+    settings[BILATERAL_FILTER].range = range;
+    updateStage(BILATERAL_FILTER);
+}
+
+/**
+ * Updates the choice of the bilateral filter algorithm.
+ * 0 is the exact filter, 1 is the bilateral grid approximation.
+ *
+ * @brief MainPanel::updateAlgorithmBF
+ * @param algorithm
+ */
+void MainPanel::updateAlgorithmBF(int algorithm) {
+    settings[BILATERAL_FILTER].algorithm = algorithm;
+    updateStage(BILATERAL_FILTER);
+}
+
+/**
+ * Measures the quality of the bilateral grid against the exact bilateral filter,
+ * with the parameters of the GUI, on the loaded image.
+ *
+ * @brief MainPanel::measureBilateralGridPSNR
+ * @return the PSNR in dB, 0 when no image is loaded
+ */
+double MainPanel::measureBilateralGridPSNR() {
+    makeCurrent();
+    double psnr = processor->measureBilateralGridPSNR(settings[BILATERAL_FILTER]);
+
+    // the targets have been used, the frame has to be drawn again
     updateGL();
+    return psnr;
 }
 
 /**
@@ -677,9 +599,7 @@ void MainPanel::updateRangeBF(float range) {
  * @param enabled
  */
 void MainPanel::updateSH(bool enabled) {
-    shEnabled = enabled;
-    onePass = true;
-    updateGL();
+    enableStage(SHARPENING, enabled);
 }
 
 /**
@@ -689,8 +609,8 @@ void MainPanel::updateSH(bool enabled) {
  * @param scaleFactor
  */
 void MainPanel::updateSH(float scaleFactor) {
-    shScaleFactor = scaleFactor;
-    updateGL();
+    settings[SHARPENING].scaleFactor = scaleFactor;
+    updateStage(SHARPENING);
 }
 
 /**
@@ -700,11 +620,7 @@ void MainPanel::updateSH(float scaleFactor) {
  * @param enabled
  */
 void MainPanel::updateED(bool enabled) {
-    edEnabled = enabled;
-    if(!enabled) {
-        onePass = true;
-    }
-    updateGL();
+    enableStage(EDGE_DETECTION, enabled);
 }
 
 /**
@@ -714,11 +630,28 @@ void MainPanel::updateED(bool enabled) {
  * @param algorithm
  */
 void MainPanel::updateED(int algorithm) {
-    edAlgorithm = algorithm;
-    if(edEnabled && algorithm > 0) {
-        onePass = false;
-    } else {
-        onePass = true;
-    }
-    updateGL();
+    settings[EDGE_DETECTION].algorithm = algorithm;
+    updateStage(EDGE_DETECTION);
+}
+
+/**
+ * Updates the gradient magnitude under which Canny finds no edge.
+ *
+ * @brief MainPanel::updateLowThresholdED
+ * @param threshold
+ */
+void MainPanel::updateLowThresholdED(float threshold) {
+    settings[EDGE_DETECTION].lowThreshold = threshold;
+    updateStage(EDGE_DETECTION);
+}
+
+/**
+ * Updates the gradient magnitude over which Canny always finds an edge.
+ *
+ * @brief MainPanel::updateHighThresholdED
+ * @param threshold
+ */
+void MainPanel::updateHighThresholdED(float threshold) {
+    settings[EDGE_DETECTION].highThreshold = threshold;
+    updateStage(EDGE_DETECTION);
 }
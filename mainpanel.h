@@ -2,90 +2,105 @@
 #define MAINPANEL_H
 
 #include <QtOpenGL>
-#include <QOpenGLFunctions>
 #include <QGLWidget>
-#include <cmath>
+#include "filterstage.h"
+#include "imageprocessor.h"
+#include "imagedecoder.h"
 
-class MainPanel : public QGLWidget, protected QGLFunctions
+class MainPanel : public QGLWidget
 {
     Q_OBJECT
 
 private:
-    float xOffset;
-    float yOffset;
-    bool onePass;
-    GLuint textureID[1];
-    GLuint fboID;
-
-    QGLShader* vertexShader;
-    QGLShader* fragmentShader;
-    QGLShaderProgram* shaderProgram;
-
-    bool gbEnabled;
-    int gbKernelSize;
-    float gbDeviation;
-    QGLShader* gbVertexShader;
-    QGLShader* gbFragmentShader;
-    QGLShaderProgram* gbShaderProgram;
-    void computeGaussianBlur();
-
-    bool bfEnabled;
-    int bfKernelSize;
-    float bfDeviation;
-    float bfRange;
-    QGLShader* bfVertexShader;
-    QGLShader* bfFragmentShader;
-    QGLShaderProgram* bfShaderProgram;
-    void computeBilateralFilter();
-
-    bool shEnabled;
-    float shScaleFactor;
-    float shKernel[9] = { 0.0f, -1.0f, 0.0f,
-                          -1.0f, 4.0f, -1.0f,
-                          0.0f, -1.0f, 0.0f
-                        };
-    QGLShader* shVertexShader;
-    QGLShader* shFragmentShader;
-    QGLShaderProgram* shShaderProgram;
-    void computeSharpening();
-
-    bool edEnabled;
-    int edAlgorithm;
-    float edKernel[9];
-    QGLShader* edVertexShader;
-    QGLShader* edFragmentShader;
-    QGLShaderProgram* edShaderProgram;
-    void computeEdgeDetection(bool);
-
-    QOpenGLVertexArrayObject* vao;
-    QOpenGLBuffer* vboPosition;
-    QOpenGLBuffer* vboTexture;
-    void createQuad();
-    void createShaders();
-
-    void onePassPaint();
-    void twoPassesPaint();
-    void calculateKernel(float kernel[], int kernelSize, float deviation);
+    // the opengl side, created with the widget's context
+    ImageProcessor* processor;
+
+    // the images are decoded in other threads, the next ones of the directory ahead of time
+    ImageDecoder decoder;
+    QStringList directoryFiles;
+    int fileIndex;
+    bool showImage(int index);
+
+    // what is displayed, scaled down when the image is too big to be loaded at once
+    QImage previewImage;
+    bool tiled;
+    void loadPreview();
+
+    // the timings of the passes are read regularly, the gpu is never waited for
+    static const int TIMING_INTERVAL = 250;
+    QTimer* timingTimer;
+
+    // while a parameter changes, the pipeline runs on a mip level no bigger than INTERACTIVE_SIZE,
+    // once it has not changed for SETTLE_DELAY milliseconds the image is rendered at its own size
+    static const int INTERACTIVE_SIZE = 1024;
+    static const int SETTLE_DELAY = 200;
+    QTimer* settleTimer;
+    bool interacting;
+
+    // the changes mark the frame dirty, and it is rendered at most once per refresh of the display:
+    // the changes made meanwhile are batched into it, the renders they would have cost are counted
+    QTimer* frameTimer;
+    QElapsedTimer lastFrameTime;
+    bool dirty;
+    int frameInterval;
+    int renderCount;
+    int skippedRenderCount;
+    void scheduleRender();
+
+    // the ordered stages run back-to-back through the render targets
+    QList<FilterStage> pipeline;
+
+    // the parameters chosen in the GUI for each algorithm
+    FilterStage settings[FILTER_TYPE_COUNT];
+    void enableStage(FilterType type, bool enabled);
+    void updateStage(FilterType type);
 
 public:
+    // the biggest kernel size handled by the 2D gaussian blur and bilateral filter shaders
+    static const int MAX_KERNEL_SIZE = ImageProcessor::MAX_KERNEL_SIZE;
+
+    // the biggest kernel size handled by the separable gaussian blur shader
+    static const int MAX_SEPARABLE_KERNEL_SIZE = ImageProcessor::MAX_SEPARABLE_KERNEL_SIZE;
+
+    // the biggest box read from a summed-area table
+    static const int MAX_BOX_KERNEL_SIZE = ImageProcessor::MAX_BOX_KERNEL_SIZE;
+
     explicit MainPanel(QWidget *parent = 0);
+    ~MainPanel();
     void loadImage(QString fileName);
-    void saveImage(QString fileName);
+    bool loadNextImage();
+    bool loadPreviousImage();
+    bool saveImage(QString fileName);
+
+    const QList<FilterStage>& getPipeline() const;
+    void setPipeline(const QList<FilterStage>& stages);
+    QString getPipelineDescription() const;
 
     void updateGB(bool);
     void updateGB(int);
     void updateGB(float);
+    void updateAlgorithmGB(int);
 
     void updateBF(bool);
     void updateBF(int);
     void updateDeviationBF(float);
     void updateRangeBF(float);
+    void updateAlgorithmBF(int);
+    double measureBilateralGridPSNR();
+
+    void setTimingEnabled(bool enabled);
+    void setLinearPrecision(bool linear);
+    QJsonObject getTimingReport();
+    int getRenderCount() const;
+    int getSkippedRenderCount() const;
 
     void updateSH(bool);
     void updateSH(float);
 
     void updateED(bool);
     void updateED(int);
+    void updateLowThresholdED(float);
+    void updateHighThresholdED(float);
 
 protected:
     void initializeGL();
@@ -93,7 +108,12 @@ protected:
     void paintGL();
 
 signals:
+    void timingsChanged(const QString& summary);
+
 public slots:
+    void collectTimings();
+    void refine();
+    void renderFrame();
 };
 
 #endif // MAINPANEL_H
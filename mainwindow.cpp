@@ -42,6 +42,12 @@ void MainWindow::createMenuBar() {
     openAction = new QAction("Open", this);
     openAction->setShortcut(QKeySequence("Ctrl+O"));
 
+    // creating the actions going through the images of the directory
+    nextAction = new QAction("Next image", this);
+    nextAction->setShortcut(QKeySequence("PgDown"));
+    previousAction = new QAction("Previous image", this);
+    previousAction->setShortcut(QKeySequence("PgUp"));
+
     // creating the save action
     saveAction = new QAction("Save", this);
     saveAction->setShortcut(QKeySequence("Ctrl+S"));
@@ -50,15 +56,30 @@ void MainWindow::createMenuBar() {
     showDockAction = new QAction("Show algorithms window", this);
     showDockAction->setShortcut(QKeySequence("Ctrl+D"));
 
+    // creating the gpu timings actions, the timings are shown in the status bar
+    showTimingsAction = new QAction("Show GPU timings", this);
+    showTimingsAction->setShortcut(QKeySequence("Ctrl+T"));
+    showTimingsAction->setCheckable(true);
+    exportTimingsAction = new QAction("Export GPU timings", this);
+
+    // creating the precision action, the passes run on linear values in half floats while it is checked
+    linearPrecisionAction = new QAction("Linear light (16-bit float)", this);
+    linearPrecisionAction->setCheckable(true);
+
     // creating the exit action
     exitAction = new QAction("Exit", this);
     exitAction->setShortcut(QKeySequence("Alt+F4"));
 
     // adding the actions to their menu
     fileMenu->addAction(openAction);
+    fileMenu->addAction(nextAction);
+    fileMenu->addAction(previousAction);
     fileMenu->addAction(saveAction);
+    fileMenu->addAction(exportTimingsAction);
     fileMenu->addAction(exitAction);
     displayMenu->addAction(showDockAction);
+    displayMenu->addAction(showTimingsAction);
+    displayMenu->addAction(linearPrecisionAction);
 }
 
 /**
@@ -82,13 +103,69 @@ void MainWindow::openFile() {
     }
 }
 
+/**
+ * Slot used to open the next image file of the directory.
+ * @brief MainWindow::openNextFile
+ */
+void MainWindow::openNextFile() {
+    centralWidget->loadNextImage();
+}
+
+/**
+ * Slot used to open the previous image file of the directory.
+ * @brief MainWindow::openPreviousFile
+ */
+void MainWindow::openPreviousFile() {
+    centralWidget->loadPreviousImage();
+}
+
 /**
  * Slot used to save an image file.
  * @brief MainWindow::saveImage
  */
 void MainWindow::saveImage() {
     QString fileName = QFileDialog::getSaveFileName(this, tr("Save Image"), QString(), tr("Image Files(*.bmp)"));
-    centralWidget->saveImage(fileName);
+    if(!fileName.isEmpty() && !centralWidget->saveImage(fileName)) {
+        QMessageBox::warning(this, tr("Save Image"), tr("Cannot save %1").arg(fileName));
+    }
+}
+
+/**
+ * Slot used to show the timings of the passes in the status bar, or to hide them.
+ * The passes are only measured while they are shown.
+ * @brief MainWindow::setTimingsVisible
+ * @param visible
+ */
+void MainWindow::setTimingsVisible(bool visible) {
+    statusBar()->setVisible(visible);
+    statusBar()->clearMessage();
+    centralWidget->setTimingEnabled(visible);
+}
+
+/**
+ * Slot used to process the image in linear light, or in its 8 bits gamma encoded values.
+ * @brief MainWindow::setLinearPrecision
+ * @param linear
+ */
+void MainWindow::setLinearPrecision(bool linear) {
+    centralWidget->setLinearPrecision(linear);
+}
+
+/**
+ * Slot used to save the timings of the passes as json.
+ * @brief MainWindow::exportTimings
+ */
+void MainWindow::exportTimings() {
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export GPU Timings"), QString(), tr("JSON Files(*.json)"));
+    if(fileName.isEmpty()) {
+        return;
+    }
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, tr("Export GPU Timings"), tr("Cannot write %1").arg(fileName));
+        return;
+    }
+    file.write(QJsonDocument(centralWidget->getTimingReport()).toJson());
 }
 
 /**
@@ -101,6 +178,11 @@ void MainWindow::createDockWidgets() {
     dockWidget = new QDockWidget(tr("Algorithms"), this);
     dockWidget->setAllowedAreas(Qt::RightDockWidgetArea);
 
+    // creating the label showing the order in which the enabled algorithms run
+    pipelineLabel = new QLabel(this);
+    pipelineLabel->setWordWrap(true);
+    updatePipelineLabel();
+
     // creating the group for the gaussian blur's parameters
     gaussianBlurGroup = new QGroupBox(tr("Gaussian Blur"));
     fillGaussianBlurGroup();
@@ -119,6 +201,7 @@ void MainWindow::createDockWidgets() {
 
     // adding all the algorithm groups to the dock widget's layout
     QVBoxLayout* layout = new QVBoxLayout();
+    layout->addWidget(pipelineLabel);
     layout->addWidget(gaussianBlurGroup);
     layout->addWidget(bilateralFilterGroup);
     layout->addWidget(sharpeningGroup);
@@ -144,48 +227,69 @@ void MainWindow::fillGaussianBlurGroup() {
     btnGaussianBlurEnable = new QCheckBox();
     btnGaussianBlurEnable->setText("Disabled");
 
+    // creating the algorithm choice parameter's GUI
+    gbAlgorithmComboBox = new QComboBox(this);
+    gbAlgorithmComboBox->addItem("Separable");
+    gbAlgorithmComboBox->addItem("2D (reference)");
+    gbAlgorithmComboBox->addItem("Box (summed-area table)");
+    gbAlgorithmComboBox->addItem("Gaussian from 3 boxes (summed-area table)");
+    gbAlgorithmComboBox->setEnabled(false);
+    gbAlgorithmLabel = new QLabel("Algorithm", this);
+
     // creating the kernel size parameter's GUI
+    // the separable kernel goes up to 65x65
     gbKernelSizeSlider = new QSlider(Qt::Horizontal, this);
-    gbKernelSizeSlider->setRange(0, 3);
+    gbKernelSizeSlider->setRange(0, (MainPanel::MAX_SEPARABLE_KERNEL_SIZE - 3) / 2);
     gbKernelSizeSlider->setEnabled(false);
     gbKernelSizeLabel = new QLabel("Kernel size: 3x3", this);
 
     // creating the deviation parameter's GUI
     gbDeviationSlider = new QSlider(Qt::Horizontal, this);
-    gbDeviationSlider->setRange(5, 50);
+    gbDeviationSlider->setRange(5, 200);
     gbDeviationSlider->setEnabled(false);
     gbDeviationLabel = new QLabel("Deviation: 0.5", this);
 
     // adding the controls to the layout
     layout->addWidget(btnGaussianBlurEnable, 0, 0);
-    layout->addWidget(gbKernelSizeLabel, 1, 0);
-    layout->addWidget(gbKernelSizeSlider, 2, 0);
-    layout->addWidget(gbDeviationLabel, 3, 0);
-    layout->addWidget(gbDeviationSlider, 4, 0);
+    layout->addWidget(gbAlgorithmLabel, 1, 0);
+    layout->addWidget(gbAlgorithmComboBox, 1, 1);
+    layout->addWidget(gbKernelSizeLabel, 2, 0);
+    layout->addWidget(gbKernelSizeSlider, 3, 0, 1, 2);
+    layout->addWidget(gbDeviationLabel, 4, 0);
+    layout->addWidget(gbDeviationSlider, 5, 0, 1, 2);
     gaussianBlurGroup->setLayout(layout);
 }
 
+/**
+ * Updates the choice of the algorithm for the gaussian blur.
+ * The 2D reference kernel is limited to 9x9, the slider is clamped accordingly.
+ * The boxes read from a summed-area table cost the same at any size, they go much further:
+ * the box up to 511x511, the gaussian made of boxes up to a deviation of 100.
+ * @brief MainWindow::changeAlgorithmGB
+ * @param value
+ */
+void MainWindow::changeAlgorithmGB(int value) {
+    int maxKernelSize = MainPanel::MAX_KERNEL_SIZE;
+    if(value == 0) {
+        maxKernelSize = MainPanel::MAX_SEPARABLE_KERNEL_SIZE;
+    } else if(value == ImageProcessor::BOX_ALGORITHM) {
+        maxKernelSize = MainPanel::MAX_BOX_KERNEL_SIZE;
+    }
+    gbKernelSizeSlider->setRange(0, (maxKernelSize - 3) / 2);
+    gbDeviationSlider->setRange(5, value == ImageProcessor::BOX_GAUSSIAN_ALGORITHM ? 1000 : 200);
+
+    // updating in the opengl widget
+    centralWidget->updateAlgorithmGB(value);
+}
+
 /**
  * Updates the value of the kernel size for the gaussian blur algorithm.
  * @brief MainWindow::changeKernelValueGB
  * @param value
  */
 void MainWindow::changeKernelValueGB(int value) {
-    int kernelSize = 3;
-    switch(value) {
-    case 0: gbKernelSizeLabel->setText(QString("Kernel size: 3x3"));
-        kernelSize = 3;
-        break;
-    case 1: gbKernelSizeLabel->setText(QString("Kernel size: 5x5"));
-        kernelSize = 5;
-        break;
-    case 2: gbKernelSizeLabel->setText(QString("Kernel size: 7x7"));
-        kernelSize = 7;
-        break;
-    case 3: gbKernelSizeLabel->setText(QString("Kernel size: 9x9"));
-        kernelSize = 9;
-        break;
-    }
+    int kernelSize = 2*value + 3;
+    gbKernelSizeLabel->setText(QString("Kernel size: %1x%1").arg(kernelSize));
 
     // updating in the opengl widget
     centralWidget->updateGB(kernelSize);
@@ -217,6 +321,13 @@ void MainWindow::fillBilateralFilterGroup() {
     btnBilateralFilterEnable = new QCheckBox();
     btnBilateralFilterEnable->setText("Disabled");
 
+    // creating the algorithm choice parameter's GUI
+    bfAlgorithmComboBox = new QComboBox(this);
+    bfAlgorithmComboBox->addItem("Exact");
+    bfAlgorithmComboBox->addItem("Bilateral grid (fast)");
+    bfAlgorithmComboBox->setEnabled(false);
+    bfAlgorithmLabel = new QLabel("Algorithm", this);
+
     // creating the kernel size parameter's GUI
     bfKernelSizeSlider = new QSlider(Qt::Horizontal, this);
     bfKernelSizeSlider->setRange(0, 3);
@@ -235,14 +346,23 @@ void MainWindow::fillBilateralFilterGroup() {
     bfRangeSlider->setEnabled(false);
     bfRangeLabel = new QLabel("Range: 0.1", this);
 
+    // creating the quality measure's GUI
+    bfPsnrButton = new QPushButton("Compare with exact", this);
+    bfPsnrButton->setEnabled(false);
+    bfPsnrLabel = new QLabel("PSNR: -", this);
+
     // adding the controls to the layout
     layout->addWidget(btnBilateralFilterEnable, 0, 0);
-    layout->addWidget(bfKernelSizeLabel, 1, 0);
-    layout->addWidget(bfKernelSizeSlider, 2, 0);
-    layout->addWidget(bfDeviationLabel, 3, 0);
-    layout->addWidget(bfDeviationSlider, 4, 0);
-    layout->addWidget(bfRangeLabel, 5, 0);
-    layout->addWidget(bfRangeSlider, 6, 0);
+    layout->addWidget(bfAlgorithmLabel, 1, 0);
+    layout->addWidget(bfAlgorithmComboBox, 1, 1);
+    layout->addWidget(bfKernelSizeLabel, 2, 0);
+    layout->addWidget(bfKernelSizeSlider, 3, 0, 1, 2);
+    layout->addWidget(bfDeviationLabel, 4, 0);
+    layout->addWidget(bfDeviationSlider, 5, 0, 1, 2);
+    layout->addWidget(bfRangeLabel, 6, 0);
+    layout->addWidget(bfRangeSlider, 7, 0, 1, 2);
+    layout->addWidget(bfPsnrButton, 8, 0);
+    layout->addWidget(bfPsnrLabel, 8, 1);
     bilateralFilterGroup->setLayout(layout);
 }
 
@@ -298,6 +418,30 @@ void MainWindow::changeRangeValueBF(int value) {
     centralWidget->updateRangeBF(range);
 }
 
+/**
+ * Updates the choice of the algorithm for the bilateral filter.
+ * The bilateral grid does not use the kernel size, its cost does not depend on the deviation.
+ * @brief MainWindow::changeAlgorithmBF
+ * @param value
+ */
+void MainWindow::changeAlgorithmBF(int value) {
+    bfKernelSizeSlider->setEnabled(btnBilateralFilterEnable->isChecked() && value == 0);
+    bfPsnrButton->setEnabled(btnBilateralFilterEnable->isChecked() && value == 1);
+    bfPsnrLabel->setText("PSNR: -");
+
+    // updating in the opengl widget
+    centralWidget->updateAlgorithmBF(value);
+}
+
+/**
+ * Measures the PSNR of the bilateral grid against the exact bilateral filter.
+ * @brief MainWindow::measurePsnrBF
+ */
+void MainWindow::measurePsnrBF() {
+    double psnr = centralWidget->measureBilateralGridPSNR();
+    bfPsnrLabel->setText(QString("PSNR: %1 dB").arg(psnr, 0, 'f', 2));
+}
+
 /**
  * Creates the GUI for the sharpening's parameters.
  * @brief MainWindow::fillSharpeningGroup
@@ -355,13 +499,30 @@ void MainWindow::fillEdgeDetectionGroup() {
     edAlgorithmComboBox->addItem("LoG");
     edAlgorithmComboBox->addItem("Sobel");
     edAlgorithmComboBox->addItem("Prewitt");
+    edAlgorithmComboBox->addItem("Canny");
     edAlgorithmComboBox->setEnabled(false);
     edAlgorithmLabel = new QLabel("Algorithm", this);
 
+    // creating the thresholds parameters' GUI, only used by Canny
+    edLowThresholdSlider = new QSlider(Qt::Horizontal, this);
+    edLowThresholdSlider->setRange(0, 100);
+    edLowThresholdSlider->setValue(5);
+    edLowThresholdSlider->setEnabled(false);
+    edLowThresholdLabel = new QLabel("Low threshold: 0.05", this);
+    edHighThresholdSlider = new QSlider(Qt::Horizontal, this);
+    edHighThresholdSlider->setRange(0, 100);
+    edHighThresholdSlider->setValue(15);
+    edHighThresholdSlider->setEnabled(false);
+    edHighThresholdLabel = new QLabel("High threshold: 0.15", this);
+
     // adding the controls to the layout
     layout->addWidget(btnEdgeDetectionEnable, 0, 0);
     layout->addWidget(edAlgorithmLabel, 1, 0);
     layout->addWidget(edAlgorithmComboBox, 1, 1);
+    layout->addWidget(edLowThresholdLabel, 2, 0);
+    layout->addWidget(edLowThresholdSlider, 2, 1);
+    layout->addWidget(edHighThresholdLabel, 3, 0);
+    layout->addWidget(edHighThresholdSlider, 3, 1);
     edgeDetectionGroup->setLayout(layout);
 }
 
@@ -371,11 +532,48 @@ void MainWindow::fillEdgeDetectionGroup() {
  * @param value
  */
 void MainWindow::changeValueED(int value){
+    bool canny = value == ImageProcessor::CANNY_ALGORITHM;
+    edLowThresholdSlider->setEnabled(btnEdgeDetectionEnable->isChecked() && canny);
+    edHighThresholdSlider->setEnabled(btnEdgeDetectionEnable->isChecked() && canny);
 
     // updating in the opengl widget
     centralWidget->updateED(value);
 }
 
+/**
+ * Updates the value of the low threshold for Canny.
+ * The high threshold is kept above it.
+ * @brief MainWindow::changeLowThresholdED
+ * @param value
+ */
+void MainWindow::changeLowThresholdED(int value) {
+    float threshold = value / 100.0;
+    edLowThresholdLabel->setText(QString("Low threshold: %1").arg(threshold));
+    if(edHighThresholdSlider->value() < value) {
+        edHighThresholdSlider->setValue(value);
+    }
+
+    // updating in the opengl widget
+    centralWidget->updateLowThresholdED(threshold);
+}
+
+/**
+ * Updates the value of the high threshold for Canny.
+ * The low threshold is kept under it.
+ * @brief MainWindow::changeHighThresholdED
+ * @param value
+ */
+void MainWindow::changeHighThresholdED(int value) {
+    float threshold = value / 100.0;
+    edHighThresholdLabel->setText(QString("High threshold: %1").arg(threshold));
+    if(edLowThresholdSlider->value() > value) {
+        edLowThresholdSlider->setValue(value);
+    }
+
+    // updating in the opengl widget
+    centralWidget->updateHighThresholdED(threshold);
+}
+
 /**
  * Updates the GUI for the gaussian blur group in the dock widget.
  * @brief MainWindow::toggleGaussianBlur
@@ -385,21 +583,16 @@ void MainWindow::toggleGaussianBlur() {
     // each time the checkbox is triggered, updating the enablement of the controls
     if(btnGaussianBlurEnable->isChecked()) {
         btnGaussianBlurEnable->setText("Enabled");
-        btnBilateralFilterEnable->setChecked(false);
-        btnSharpeningEnable->setChecked(false);
-        btnEdgeDetectionEnable->setChecked(false);
-
-        toggleBilateralFilter();
-        toggleSharpening();
-        toggleEdgeDetection();
     } else {
         btnGaussianBlurEnable->setText("Disabled");
     }
+    gbAlgorithmComboBox->setEnabled(btnGaussianBlurEnable->isChecked());
     gbKernelSizeSlider->setEnabled(btnGaussianBlurEnable->isChecked());
     gbDeviationSlider->setEnabled(btnGaussianBlurEnable->isChecked());
 
     // updating in the opengl widget
     centralWidget->updateGB(btnGaussianBlurEnable->isChecked());
+    updatePipelineLabel();
 }
 
 /**
@@ -411,22 +604,18 @@ void MainWindow::toggleBilateralFilter() {
     // each time the checkbox is triggered, updating the enablement of the controls
     if(btnBilateralFilterEnable->isChecked()) {
         btnBilateralFilterEnable->setText("Enabled");
-        btnGaussianBlurEnable->setChecked(false);
-        btnSharpeningEnable->setChecked(false);
-        btnEdgeDetectionEnable->setChecked(false);
-
-        toggleGaussianBlur();
-        toggleSharpening();
-        toggleEdgeDetection();
     } else {
         btnBilateralFilterEnable->setText("Disabled");
     }
-    bfKernelSizeSlider->setEnabled(btnBilateralFilterEnable->isChecked());
+    bfAlgorithmComboBox->setEnabled(btnBilateralFilterEnable->isChecked());
+    bfKernelSizeSlider->setEnabled(btnBilateralFilterEnable->isChecked() && bfAlgorithmComboBox->currentIndex() == 0);
     bfDeviationSlider->setEnabled(btnBilateralFilterEnable->isChecked());
     bfRangeSlider->setEnabled(btnBilateralFilterEnable->isChecked());
+    bfPsnrButton->setEnabled(btnBilateralFilterEnable->isChecked() && bfAlgorithmComboBox->currentIndex() == 1);
 
     // updating in the opengl widget
     centralWidget->updateBF(btnBilateralFilterEnable->isChecked());
+    updatePipelineLabel();
 }
 
 /**
@@ -438,13 +627,6 @@ void MainWindow::toggleSharpening() {
     // each time the checkbox is triggered, updating the enablement of the controls
     if(btnSharpeningEnable->isChecked()) {
         btnSharpeningEnable->setText("Enabled");
-        btnBilateralFilterEnable->setChecked(false);
-        btnGaussianBlurEnable->setChecked(false);
-        btnEdgeDetectionEnable->setChecked(false);
-
-        toggleBilateralFilter();
-        toggleGaussianBlur();
-        toggleEdgeDetection();
     } else {
         btnSharpeningEnable->setText("Disabled");
     }
@@ -452,6 +634,7 @@ void MainWindow::toggleSharpening() {
 
     // updating in the opengl widget
     centralWidget->updateSH(btnSharpeningEnable->isChecked());
+    updatePipelineLabel();
 }
 
 /**
@@ -463,20 +646,26 @@ void MainWindow::toggleEdgeDetection() {
     // each time the checkbox is triggered, updating the enablement of the controls
     if(btnEdgeDetectionEnable->isChecked()) {
         btnEdgeDetectionEnable->setText("Enabled");
-        btnBilateralFilterEnable->setChecked(false);
-        btnGaussianBlurEnable->setChecked(false);
-        btnSharpeningEnable->setChecked(false);
-
-        toggleBilateralFilter();
-        toggleSharpening();
-        toggleGaussianBlur();
     } else {
         btnEdgeDetectionEnable->setText("Disabled");
     }
     edAlgorithmComboBox->setEnabled(btnEdgeDetectionEnable->isChecked());
+    bool canny = edAlgorithmComboBox->currentIndex() == ImageProcessor::CANNY_ALGORITHM;
+    edLowThresholdSlider->setEnabled(btnEdgeDetectionEnable->isChecked() && canny);
+    edHighThresholdSlider->setEnabled(btnEdgeDetectionEnable->isChecked() && canny);
 
     // updating in the opengl widget
     centralWidget->updateED(btnEdgeDetectionEnable->isChecked());
+    updatePipelineLabel();
+}
+
+/**
+ * Shows the order in which the enabled algorithms are chained.
+ * Algorithms run in the order they have been enabled.
+ * @brief MainWindow::updatePipelineLabel
+ */
+void MainWindow::updatePipelineLabel() {
+    pipelineLabel->setText(QString("Pipeline: %1").arg(centralWidget->getPipelineDescription()));
 }
 
 /**
@@ -502,18 +691,29 @@ void MainWindow::connectActions() {
     connect(showDockAction, SIGNAL(triggered()), this, SLOT(setDockVisible()));
     connect(saveAction, SIGNAL(triggered()), this, SLOT(saveImage()));
     connect(openAction, SIGNAL(triggered()), this, SLOT(openFile()));
+    connect(nextAction, SIGNAL(triggered()), this, SLOT(openNextFile()));
+    connect(previousAction, SIGNAL(triggered()), this, SLOT(openPreviousFile()));
+    connect(showTimingsAction, SIGNAL(toggled(bool)), this, SLOT(setTimingsVisible(bool)));
+    connect(exportTimingsAction, SIGNAL(triggered()), this, SLOT(exportTimings()));
+    connect(linearPrecisionAction, SIGNAL(toggled(bool)), this, SLOT(setLinearPrecision(bool)));
+    connect(centralWidget, SIGNAL(timingsChanged(QString)), statusBar(), SLOT(showMessage(QString)));
     connect(exitAction, SIGNAL(triggered()), qApp, SLOT(quit()));
 
+    connect(gbAlgorithmComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(changeAlgorithmGB(int)));
     connect(gbKernelSizeSlider, SIGNAL(valueChanged(int)), this, SLOT(changeKernelValueGB(int)));
     connect(gbDeviationSlider, SIGNAL(valueChanged(int)), this, SLOT(changeDeviationValueGB(int)));
 
+    connect(bfAlgorithmComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(changeAlgorithmBF(int)));
     connect(bfKernelSizeSlider, SIGNAL(valueChanged(int)), this, SLOT(changeKernelValueBF(int)));
     connect(bfDeviationSlider, SIGNAL(valueChanged(int)), this, SLOT(changeDeviationValueBF(int)));
     connect(bfRangeSlider, SIGNAL(valueChanged(int)), this, SLOT(changeRangeValueBF(int)));
+    connect(bfPsnrButton, SIGNAL(released()), this, SLOT(measurePsnrBF()));
 
     connect(shScaleFactorSlider, SIGNAL(valueChanged(int)), this, SLOT(changeValueSH(int)));
 
     connect(edAlgorithmComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(changeValueED(int)));
+    connect(edLowThresholdSlider, SIGNAL(valueChanged(int)), this, SLOT(changeLowThresholdED(int)));
+    connect(edHighThresholdSlider, SIGNAL(valueChanged(int)), this, SLOT(changeHighThresholdED(int)));
 }
 
 MainWindow::~MainWindow() {
@@ -19,36 +19,54 @@ public:
 
 public slots:
     void openFile();
+    void openNextFile();
+    void openPreviousFile();
     void saveImage();
     void setDockVisible();
+    void setTimingsVisible(bool visible);
+    void setLinearPrecision(bool linear);
+    void exportTimings();
 
     void toggleGaussianBlur();
     void toggleBilateralFilter();
     void toggleSharpening();
     void toggleEdgeDetection();
 
+    void changeAlgorithmGB(int);
     void changeKernelValueGB(int);
     void changeDeviationValueGB(int);
 
     void changeKernelValueBF(int);
     void changeDeviationValueBF(int);
     void changeRangeValueBF(int);
+    void changeAlgorithmBF(int);
+    void measurePsnrBF();
 
     void changeValueSH(int);
 
     void changeValueED(int);
+    void changeLowThresholdED(int);
+    void changeHighThresholdED(int);
 
 private:
     Ui::MainWindow *ui;
     MainPanel* centralWidget;
     QDockWidget* dockWidget;
+    QLabel* pipelineLabel;
     QAction* openAction;
     QAction* saveAction;
+    QAction* nextAction;
+    QAction* previousAction;
     QAction* showDockAction;
+    QAction* showTimingsAction;
+    QAction* linearPrecisionAction;
+    QAction* exportTimingsAction;
     QAction* exitAction;
 
     QGroupBox* gaussianBlurGroup;
     QCheckBox* btnGaussianBlurEnable;
+    QComboBox* gbAlgorithmComboBox;
+    QLabel* gbAlgorithmLabel;
     QSlider* gbKernelSizeSlider;
     QSlider* gbDeviationSlider;
     QLabel* gbKernelSizeLabel;
@@ -56,6 +74,10 @@ private:
 
     QGroupBox* bilateralFilterGroup;
     QCheckBox* btnBilateralFilterEnable;
+    QComboBox* bfAlgorithmComboBox;
+    QLabel* bfAlgorithmLabel;
+    QPushButton* bfPsnrButton;
+    QLabel* bfPsnrLabel;
     QSlider* bfKernelSizeSlider;
     QSlider* bfDeviationSlider;
     QSlider* bfRangeSlider;
@@ -72,6 +94,10 @@ private:
     QCheckBox* btnEdgeDetectionEnable;
     QComboBox* edAlgorithmComboBox;
     QLabel* edAlgorithmLabel;
+    QSlider* edLowThresholdSlider;
+    QSlider* edHighThresholdSlider;
+    QLabel* edLowThresholdLabel;
+    QLabel* edHighThresholdLabel;
 
     void createMenuBar();
     void createCentralWidget();
@@ -81,6 +107,7 @@ private:
     void fillSharpeningGroup();
     void fillEdgeDetectionGroup();
     void connectActions();
+    void updatePipelineLabel();
 };
 
 #endif // MAINWINDOW_H
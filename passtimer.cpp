@@ -0,0 +1,269 @@
+#include "passtimer.h"
+#include <QJsonArray>
+
+const int PassTimer::FRAME_COUNT;
+const int PassTimer::MAX_PASS_COUNT;
+const int PassTimer::WINDOW_SIZE;
+
+/**
+ * Nothing is measured before initialize is called with a current context.
+ *
+ * @brief PassTimer::PassTimer
+ */
+PassTimer::PassTimer() {
+    gl33 = NULL;
+    for(int frame = 0; frame < FRAME_COUNT; frame++) {
+        for(int pass = 0; pass < MAX_PASS_COUNT; pass++) {
+            queryIDs[frame][pass] = 0;
+        }
+        framePixelCounts[frame] = 0;
+        framePending[frame] = false;
+    }
+    currentFrame = 0;
+    passStarted = false;
+}
+
+/**
+ * Creates the queries in the current context.
+ *
+ * @brief PassTimer::initialize
+ * @param gl33 the functions of opengl 3.3, NULL when they are not available
+ */
+void PassTimer::initialize(QOpenGLFunctions_3_3_Core* gl33) {
+    this->gl33 = gl33;
+    if(gl33 == NULL) {
+        return;
+    }
+
+    // remembering the driver, the timings are only comparable with the same one
+    vendor = QString((const char*)gl33->glGetString(GL_VENDOR));
+    renderer = QString((const char*)gl33->glGetString(GL_RENDERER));
+    version = QString((const char*)gl33->glGetString(GL_VERSION));
+
+    for(int frame = 0; frame < FRAME_COUNT; frame++) {
+        gl33->glGenQueries(MAX_PASS_COUNT, queryIDs[frame]);
+    }
+}
+
+/**
+ * Releases the queries.
+ * The context they have been created in has to be current.
+ *
+ * @brief PassTimer::release
+ */
+void PassTimer::release() {
+    if(gl33 == NULL) {
+        return;
+    }
+    for(int frame = 0; frame < FRAME_COUNT; frame++) {
+        gl33->glDeleteQueries(MAX_PASS_COUNT, queryIDs[frame]);
+    }
+    gl33 = NULL;
+}
+
+/**
+ * @brief PassTimer::isAvailable
+ * @return whether the passes can be measured
+ */
+bool PassTimer::isAvailable() const {
+    return gl33 != NULL;
+}
+
+/**
+ * Starts measuring a frame with the set of queries measured two frames ago.
+ * When the gpu is still not done with them, their results are dropped rather than waited for.
+ *
+ * @brief PassTimer::beginFrame
+ * @param pixelCount the number of pixels each pass computes
+ */
+void PassTimer::beginFrame(qint64 pixelCount) {
+    if(gl33 == NULL) {
+        return;
+    }
+    collect(currentFrame);
+    framePending[currentFrame] = false;
+    frameNames[currentFrame].clear();
+    framePixelCounts[currentFrame] = pixelCount;
+    passStarted = false;
+}
+
+/**
+ * Starts measuring a pass.
+ * The passes after the first MAX_PASS_COUNT ones of a frame are not measured.
+ *
+ * @brief PassTimer::beginPass
+ * @param name
+ */
+void PassTimer::beginPass(const QString& name) {
+    if(gl33 == NULL || frameNames[currentFrame].size() >= MAX_PASS_COUNT) {
+        return;
+    }
+    gl33->glBeginQuery(GL_TIME_ELAPSED, queryIDs[currentFrame][frameNames[currentFrame].size()]);
+    frameNames[currentFrame].append(name);
+    passStarted = true;
+}
+
+/**
+ * Stops measuring the current pass.
+ *
+ * @brief PassTimer::endPass
+ */
+void PassTimer::endPass() {
+    if(!passStarted) {
+        return;
+    }
+    gl33->glEndQuery(GL_TIME_ELAPSED);
+    passStarted = false;
+}
+
+/**
+ * Ends the frame, the next one is measured with the other set of queries.
+ *
+ * @brief PassTimer::endFrame
+ */
+void PassTimer::endFrame() {
+    if(gl33 == NULL) {
+        return;
+    }
+    framePending[currentFrame] = !frameNames[currentFrame].isEmpty();
+    currentFrame = (currentFrame + 1) % FRAME_COUNT;
+}
+
+/**
+ * Reads the results of the measured frames the gpu is done with, the oldest first.
+ * Does not wait for the others.
+ *
+ * @brief PassTimer::collect
+ */
+void PassTimer::collect() {
+    if(gl33 == NULL) {
+        return;
+    }
+    for(int i = 0; i < FRAME_COUNT; i++) {
+        collect((currentFrame + i) % FRAME_COUNT);
+    }
+}
+
+/**
+ * Reads the results of a frame if the gpu is done with it.
+ * The queries end in order, so the frame is done when its last query is.
+ *
+ * @brief PassTimer::collect
+ * @param frame
+ */
+void PassTimer::collect(int frame) {
+    if(!framePending[frame]) {
+        return;
+    }
+    const QStringList& names = frameNames[frame];
+    GLint available = 0;
+    gl33->glGetQueryObjectiv(queryIDs[frame][names.size() - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available) {
+        return;
+    }
+    framePending[frame] = false;
+
+    // the samples of other passes are meaningless for the new ones
+    if(names != passNames) {
+        passNames = names;
+        passMilliseconds.clear();
+        passMegapixels.clear();
+        for(int pass = 0; pass < names.size(); pass++) {
+            passMilliseconds.append(QList<double>());
+            passMegapixels.append(QList<double>());
+        }
+    }
+
+    // keeping the last samples of each pass
+    for(int pass = 0; pass < names.size(); pass++) {
+        GLuint64 nanoseconds = 0;
+        gl33->glGetQueryObjectui64v(queryIDs[frame][pass], GL_QUERY_RESULT, &nanoseconds);
+        passMilliseconds[pass].append(nanoseconds / 1000000.0);
+        passMegapixels[pass].append(framePixelCounts[frame] / 1000000.0);
+        if(passMilliseconds[pass].size() > WINDOW_SIZE) {
+            passMilliseconds[pass].removeFirst();
+            passMegapixels[pass].removeFirst();
+        }
+    }
+}
+
+/**
+ * Gets the timings of the passes of the last measured frames.
+ *
+ * @brief PassTimer::getTimings
+ * @return the timings, in the order of the passes
+ */
+QList<PassTiming> PassTimer::getTimings() const {
+    QList<PassTiming> timings;
+    for(int pass = 0; pass < passNames.size(); pass++) {
+        double milliseconds = 0.0;
+        double megapixels = 0.0;
+        for(int i = 0; i < passMilliseconds[pass].size(); i++) {
+            milliseconds += passMilliseconds[pass][i];
+            megapixels += passMegapixels[pass][i];
+        }
+
+        PassTiming timing;
+        timing.name = passNames[pass];
+        timing.sampleCount = passMilliseconds[pass].size();
+        timing.milliseconds = timing.sampleCount > 0 ? milliseconds / timing.sampleCount : 0.0;
+        timing.megapixelsPerSecond = milliseconds > 0.0 ? megapixels / (milliseconds / 1000.0) : 0.0;
+        timings.append(timing);
+    }
+    return timings;
+}
+
+/**
+ * Describes the timings in one line, for the status bar.
+ *
+ * @brief PassTimer::getSummary
+ * @return the time and the throughput of each pass and the total time
+ */
+QString PassTimer::getSummary() const {
+    if(gl33 == NULL) {
+        return QString("GPU timings need OpenGL 3.3");
+    }
+
+    QStringList parts;
+    double total = 0.0;
+    for(const PassTiming& timing : getTimings()) {
+        parts << QString("%1: %2 ms, %3 MP/s").arg(timing.name)
+                 .arg(timing.milliseconds, 0, 'f', 2)
+                 .arg(timing.megapixelsPerSecond, 0, 'f', 0);
+        total += timing.milliseconds;
+    }
+    if(parts.isEmpty()) {
+        return QString("No GPU timing yet");
+    }
+    parts << QString("total: %1 ms").arg(total, 0, 'f', 2);
+    return parts.join(" | ");
+}
+
+/**
+ * Describes the timings and the driver they have been measured with,
+ * so that they can be compared between versions.
+ *
+ * @brief PassTimer::toJson
+ * @return the json object
+ */
+QJsonObject PassTimer::toJson() const {
+    QJsonArray passes;
+    double total = 0.0;
+    for(const PassTiming& timing : getTimings()) {
+        QJsonObject pass;
+        pass["name"] = timing.name;
+        pass["milliseconds"] = timing.milliseconds;
+        pass["megapixelsPerSecond"] = timing.megapixelsPerSecond;
+        pass["samples"] = timing.sampleCount;
+        passes.append(pass);
+        total += timing.milliseconds;
+    }
+
+    QJsonObject object;
+    object["vendor"] = vendor;
+    object["renderer"] = renderer;
+    object["version"] = version;
+    object["passes"] = passes;
+    object["totalMilliseconds"] = total;
+    return object;
+}
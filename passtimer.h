@@ -0,0 +1,70 @@
+#ifndef PASSTIMER_H
+#define PASSTIMER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/**
+ * The time taken by the gpu for a pass of the pipeline, averaged over the last frames.
+ */
+struct PassTiming {
+    QString name;
+    double milliseconds;
+    double megapixelsPerSecond;
+    int sampleCount;
+};
+
+/**
+ * Measures every pass of the pipeline with GL_TIME_ELAPSED queries.
+ * The queries of a frame are only read once the gpu is done with them, while the next frame
+ * is measured with the other set: reading them never waits for the gpu.
+ * Without opengl 3.3, nothing is measured.
+ */
+class PassTimer
+{
+private:
+    QOpenGLFunctions_3_3_Core* gl33;
+
+    // the driver the timings have been measured with
+    QString vendor;
+    QString renderer;
+    QString version;
+
+    // two sets of queries, one being measured while the other one is waited for
+    static const int FRAME_COUNT = 2;
+    static const int MAX_PASS_COUNT = 32;
+    GLuint queryIDs[FRAME_COUNT][MAX_PASS_COUNT];
+    QStringList frameNames[FRAME_COUNT];
+    qint64 framePixelCounts[FRAME_COUNT];
+    bool framePending[FRAME_COUNT];
+    int currentFrame;
+    bool passStarted;
+
+    // the last samples of each pass, reset when the passes change
+    static const int WINDOW_SIZE = 30;
+    QStringList passNames;
+    QList<QList<double> > passMilliseconds;
+    QList<QList<double> > passMegapixels;
+    void collect(int frame);
+
+public:
+    PassTimer();
+    void initialize(QOpenGLFunctions_3_3_Core* gl33);
+    void release();
+    bool isAvailable() const;
+
+    void beginFrame(qint64 pixelCount);
+    void beginPass(const QString& name);
+    void endPass();
+    void endFrame();
+    void collect();
+
+    QList<PassTiming> getTimings() const;
+    QString getSummary() const;
+    QJsonObject toJson() const;
+};
+
+#endif // PASSTIMER_H
@@ -0,0 +1,247 @@
+#include "programcache.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+/**
+ * Nothing is cached before initialize is called with a current context.
+ *
+ * @brief ProgramCache::ProgramCache
+ */
+ProgramCache::ProgramCache() {
+    getProgramBinary = NULL;
+    programBinary = NULL;
+    programParameteri = NULL;
+    loadedCount = 0;
+    compiledCount = 0;
+}
+
+/**
+ * Resolves the functions of the program binaries in the current context,
+ * and identifies its driver.
+ *
+ * @brief ProgramCache::initialize
+ */
+void ProgramCache::initialize() {
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QOpenGLFunctions* functions = context->functions();
+
+    // the binaries are part of opengl 4.1, and an extension of the older versions
+    QPair<int, int> version = context->format().version();
+    bool supported = version >= qMakePair(4, 1) || context->hasExtension("GL_ARB_get_program_binary");
+    GLint formatCount = 0;
+    if(supported) {
+        functions->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    }
+    if(formatCount > 0) {
+        getProgramBinary = (GetProgramBinary)context->getProcAddress("glGetProgramBinary");
+        programBinary = (ProgramBinary)context->getProcAddress("glProgramBinary");
+        programParameteri = (ProgramParameteri)context->getProcAddress("glProgramParameteri");
+    }
+
+    // a binary only works with the driver that linked it
+    driver = QByteArray((const char*)functions->glGetString(GL_VENDOR)) + '\n'
+            + QByteArray((const char*)functions->glGetString(GL_RENDERER)) + '\n'
+            + QByteArray((const char*)functions->glGetString(GL_VERSION));
+    directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders";
+}
+
+/**
+ * @brief ProgramCache::isAvailable
+ * @return whether the programs can be kept on disk
+ */
+bool ProgramCache::isAvailable() const {
+    return getProgramBinary != NULL && programBinary != NULL && programParameteri != NULL;
+}
+
+/**
+ * @brief ProgramCache::getLoadedCount
+ * @return the number of programs loaded from the disk
+ */
+int ProgramCache::getLoadedCount() const {
+    return loadedCount;
+}
+
+/**
+ * @brief ProgramCache::getCompiledCount
+ * @return the number of programs compiled from their sources
+ */
+int ProgramCache::getCompiledCount() const {
+    return compiledCount;
+}
+
+/**
+ * Creates a linked program, from its binary on disk when there is one,
+ * or from its sources, in which case its binary is kept for the next time.
+ *
+ * @brief ProgramCache::createProgram
+ * @param vertexShader the compiled vertex shader, shared by every program
+ * @param vertexSource its source
+ * @param fragmentSource the source of the fragment shader
+ * @return the program, which may not be linked when the sources are invalid
+ */
+QOpenGLShaderProgram* ProgramCache::createProgram(QOpenGLShader* vertexShader, const QByteArray& vertexSource, const QByteArray& fragmentSource) {
+    QString file = fileName(vertexSource, fragmentSource);
+    QOpenGLShaderProgram* program = loadProgram(file);
+    if(program != NULL) {
+        return program;
+    }
+
+    program = new QOpenGLShaderProgram;
+    program->addShader(vertexShader);
+    program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    linkProgram(program, file);
+    return program;
+}
+
+/**
+ * Creates a linked compute program, from its binary on disk when there is one,
+ * or from its source, in which case its binary is kept for the next time.
+ *
+ * @brief ProgramCache::createComputeProgram
+ * @param computeSource the source of the compute shader
+ * @return the program, which may not be linked when the source is invalid
+ */
+QOpenGLShaderProgram* ProgramCache::createComputeProgram(const QByteArray& computeSource) {
+    QString file = fileName(QByteArray(), computeSource);
+    QOpenGLShaderProgram* program = loadProgram(file);
+    if(program != NULL) {
+        return program;
+    }
+
+    program = new QOpenGLShaderProgram;
+    program->addShaderFromSourceCode(QOpenGLShader::Compute, computeSource);
+    linkProgram(program, file);
+    return program;
+}
+
+/**
+ * Creates a program from its binary on disk.
+ *
+ * @brief ProgramCache::loadProgram
+ * @param file
+ * @return the linked program, NULL when there is no binary or the driver rejects it
+ */
+QOpenGLShaderProgram* ProgramCache::loadProgram(const QString& file) {
+    if(!isAvailable()) {
+        return NULL;
+    }
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram;
+    if(load(program, file)) {
+        loadedCount++;
+        return program;
+    }
+    delete program;
+    return NULL;
+}
+
+/**
+ * Links a program whose shaders have been added, and keeps its binary.
+ * The binary has to be asked for before the link.
+ *
+ * @brief ProgramCache::linkProgram
+ * @param program
+ * @param file
+ */
+void ProgramCache::linkProgram(QOpenGLShaderProgram* program, const QString& file) {
+    if(isAvailable()) {
+        programParameteri(program->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    compiledCount++;
+    if(program->link() && isAvailable()) {
+        save(program, file);
+    }
+}
+
+/**
+ * Gets the file of a program's binary, named after a hash of the driver and of the sources.
+ *
+ * @brief ProgramCache::fileName
+ * @param vertexSource
+ * @param fragmentSource
+ * @return the path of the file
+ */
+QString ProgramCache::fileName(const QByteArray& vertexSource, const QByteArray& fragmentSource) const {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(driver);
+    hash.addData(vertexSource);
+    hash.addData(fragmentSource);
+    return directory + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+}
+
+/**
+ * Loads a program's binary into it.
+ * A binary the driver rejects is deleted.
+ *
+ * @brief ProgramCache::load
+ * @param program a program without any shader
+ * @param file
+ * @return true if the program is linked
+ */
+bool ProgramCache::load(QOpenGLShaderProgram* program, const QString& file) {
+    QFile input(file);
+    if(!input.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // the format of the binary, then the binary
+    QDataStream stream(&input);
+    quint32 format = 0;
+    QByteArray binary;
+    stream >> format >> binary;
+    input.close();
+
+    // without any shader, linking only checks that the binary has been accepted
+    if(stream.status() == QDataStream::Ok && program->create()) {
+        programBinary(program->programId(), format, binary.constData(), binary.size());
+        if(program->link()) {
+            return true;
+        }
+    }
+    QFile::remove(file);
+    return false;
+}
+
+/**
+ * Writes a linked program's binary.
+ * The file is written under another name and renamed, a concurrent start never reads half a binary.
+ *
+ * @brief ProgramCache::save
+ * @param program
+ * @param file
+ */
+void ProgramCache::save(QOpenGLShaderProgram* program, const QString& file) {
+    QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
+    GLint length = 0;
+    functions->glGetProgramiv(program->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) {
+        return;
+    }
+    QByteArray binary(length, 0);
+    GLenum format = 0;
+    getProgramBinary(program->programId(), length, &length, &format, binary.data());
+    binary.resize(length);
+
+    QDir().mkpath(directory);
+    QSaveFile output(file);
+    if(!output.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&output);
+    stream << (quint32)format << binary;
+    output.commit();
+}
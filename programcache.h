@@ -0,0 +1,52 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <QByteArray>
+#include <QOpenGLFunctions>
+#include <QOpenGLShader>
+#include <QOpenGLShaderProgram>
+#include <QString>
+
+/**
+ * Keeps the linked shader programs on disk with glGetProgramBinary, and loads them back with glProgramBinary
+ * rather than compiling and linking their sources again.
+ * A binary is found by a hash of the driver and of the sources: a new driver or an edited shader
+ * misses the cache and is compiled, a binary the driver rejects is deleted and compiled again.
+ * Without GL_ARB_get_program_binary, the programs are always compiled.
+ */
+class ProgramCache
+{
+private:
+    typedef void (QOPENGLF_APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (QOPENGLF_APIENTRYP ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (QOPENGLF_APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+    GetProgramBinary getProgramBinary;
+    ProgramBinary programBinary;
+    ProgramParameteri programParameteri;
+
+    // where the binaries are kept, and the driver they have been linked by
+    QString directory;
+    QByteArray driver;
+
+    // the number of programs loaded from the disk and compiled, since the initialization
+    int loadedCount;
+    int compiledCount;
+
+    QString fileName(const QByteArray& vertexSource, const QByteArray& fragmentSource) const;
+    QOpenGLShaderProgram* loadProgram(const QString& file);
+    void linkProgram(QOpenGLShaderProgram* program, const QString& file);
+    bool load(QOpenGLShaderProgram* program, const QString& file);
+    void save(QOpenGLShaderProgram* program, const QString& file);
+
+public:
+    ProgramCache();
+    void initialize();
+    bool isAvailable() const;
+    int getLoadedCount() const;
+    int getCompiledCount() const;
+
+    QOpenGLShaderProgram* createProgram(QOpenGLShader* vertexShader, const QByteArray& vertexSource, const QByteArray& fragmentSource);
+    QOpenGLShaderProgram* createComputeProgram(const QByteArray& computeSource);
+};
+
+#endif // PROGRAMCACHE_H
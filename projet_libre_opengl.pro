@@ -15,10 +15,25 @@ TEMPLATE = app
 
 SOURCES += main.cpp\
         mainwindow.cpp \
-    mainpanel.cpp
+    mainpanel.cpp \
+    imageprocessor.cpp \
+    batchprocessor.cpp \
+    cpuprocessor.cpp \
+    imagedecoder.cpp \
+    passtimer.cpp \
+    programcache.cpp \
+    streamprocessor.cpp
 
 HEADERS  += mainwindow.h \
     mainpanel.h \
+    filterstage.h \
+    imageprocessor.h \
+    batchprocessor.h \
+    cpuprocessor.h \
+    imagedecoder.h \
+    passtimer.h \
+    programcache.h \
+    streamprocessor.h \
     observable.h \
     observer.h
 
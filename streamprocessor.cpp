@@ -0,0 +1,484 @@
+#include "streamprocessor.h"
+#include "batchprocessor.h"
+#include "imageprocessor.h"
+#include "imagedecoder.h"
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QRegExp>
+#include <QRunnable>
+#include <QTextStream>
+
+const int StreamProcessor::DEFAULT_PREFETCH_COUNT;
+const int StreamProcessor::ENCODE_QUEUE_SIZE;
+const int StreamProcessor::REPORT_INTERVAL;
+
+/**
+ * Decodes one frame in the pool and gives it back to the processor.
+ */
+class StreamProcessor::DecodeTask : public QRunnable
+{
+private:
+    StreamProcessor* processor;
+    int index;
+
+public:
+    DecodeTask(StreamProcessor* processor, int index) :
+        processor(processor),
+        index(index) {
+    }
+
+    void run() {
+        QString error;
+        QImage image = processor->readFrame(index, error);
+        processor->finishDecode(index, image, error);
+    }
+};
+
+/**
+ * Encodes one processed frame in the pool, and frees its slot in the encoding queue.
+ */
+class StreamProcessor::EncodeTask : public QRunnable
+{
+private:
+    StreamProcessor* processor;
+    int index;
+    QImage image;
+
+public:
+    EncodeTask(StreamProcessor* processor, int index, const QImage& image) :
+        processor(processor),
+        index(index),
+        image(image) {
+    }
+
+    void run() {
+        processor->writeFrame(index, image);
+        processor->encodeSlots.release();
+    }
+};
+
+/**
+ * Nothing is read before run is called.
+ *
+ * @brief StreamProcessor::StreamProcessor
+ */
+StreamProcessor::StreamProcessor() :
+    encodeSlots(ENCODE_QUEUE_SIZE) {
+    firstNumber = 0;
+    frameCount = 0;
+    prefetchCount = DEFAULT_PREFETCH_COUNT;
+    nextDecodedIndex = 0;
+}
+
+/**
+ * Waits for the decodings and the encodings in progress, they use this processor.
+ *
+ * @brief StreamProcessor::~StreamProcessor
+ */
+StreamProcessor::~StreamProcessor() {
+    decodePool.waitForDone();
+    encodePool.waitForDone();
+}
+
+/**
+ * Tells whether the application has been launched in streaming mode.
+ *
+ * @brief StreamProcessor::isRequested
+ * @param argc
+ * @param argv
+ * @return true if --stream is in the arguments
+ */
+bool StreamProcessor::isRequested(int argc, char *argv[]) {
+    for(int i = 1; i < argc; i++) {
+        if(QString(argv[i]) == "--stream") {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Gets the file of a frame of an image sequence.
+ *
+ * @brief StreamProcessor::frameFileName
+ * @param index the index of the frame, from 0
+ * @return the path of the file
+ */
+QString StreamProcessor::frameFileName(int index) const {
+    if(!inputFiles.isEmpty()) {
+        return inputFiles[index];
+    }
+    return QString::asprintf(inputPattern.toLocal8Bit().constData(), firstNumber + index);
+}
+
+/**
+ * Reads a frame, in any thread: the raw file is opened by each reading.
+ *
+ * @brief StreamProcessor::readFrame
+ * @param index the index of the frame, from 0
+ * @param error why the frame cannot be read
+ * @return the frame in QImage::Format_RGBA8888, null when it cannot be read
+ */
+QImage StreamProcessor::readFrame(int index, QString& error) const {
+    if(yuvFileName.isEmpty()) {
+        DecodedImage decoded = ImageDecoder::decode(frameFileName(index));
+        error = decoded.error;
+        return decoded.image;
+    }
+
+    // a yuv 4:2:0 frame is a plane of luma followed by two planes of chroma of a quarter of its size
+    qint64 frameBytes = (qint64)frameSize.width() * frameSize.height() * 3 / 2;
+    QFile file(yuvFileName);
+    if(!file.open(QIODevice::ReadOnly) || !file.seek(index * frameBytes)) {
+        error = file.errorString();
+        return QImage();
+    }
+    QByteArray frame = file.read(frameBytes);
+    if(frame.size() != frameBytes) {
+        error = QString("truncated frame");
+        return QImage();
+    }
+    return yuvToImage(frame, frameSize);
+}
+
+/**
+ * Starts decoding the frames from the next one not started yet up to prefetchCount frames after a frame.
+ *
+ * @brief StreamProcessor::prefetch
+ * @param index the frame about to be processed
+ */
+void StreamProcessor::prefetch(int index) {
+    int lastIndex = qMin(index + prefetchCount, frameCount);
+    for(; nextDecodedIndex < lastIndex; nextDecodedIndex++) {
+        decodePool.start(new DecodeTask(this, nextDecodedIndex));
+    }
+}
+
+/**
+ * Keeps a decoded frame until it is taken.
+ *
+ * @brief StreamProcessor::finishDecode
+ * @param index
+ * @param image
+ * @param error
+ */
+void StreamProcessor::finishDecode(int index, const QImage& image, const QString& error) {
+    QMutexLocker locker(&mutex);
+    decodedFrames.insert(index, image);
+    decodeErrors.insert(index, error);
+    decodedCondition.wakeAll();
+}
+
+/**
+ * Takes a frame out of the decoded ones, waiting for it if it is still being decoded.
+ *
+ * @brief StreamProcessor::takeFrame
+ * @param index
+ * @param error why the frame cannot be read
+ * @return the frame, null when it cannot be read
+ */
+QImage StreamProcessor::takeFrame(int index, QString& error) {
+    QMutexLocker locker(&mutex);
+    while(!decodedFrames.contains(index)) {
+        decodedCondition.wait(&mutex);
+    }
+    error = decodeErrors.take(index);
+    return decodedFrames.take(index);
+}
+
+/**
+ * Hands a processed frame to the encoding pool, waiting when the encoding queue is full.
+ *
+ * @brief StreamProcessor::encode
+ * @param index
+ * @param image the processed frame, null when the processing failed
+ */
+void StreamProcessor::encode(int index, const QImage& image) {
+    if(image.isNull()) {
+        QTextStream(stderr) << "cannot process frame " << index << endl;
+        failedCount.ref();
+        return;
+    }
+    encodeSlots.acquire();
+    encodePool.start(new EncodeTask(this, index, image));
+}
+
+/**
+ * Writes a processed frame, in an encoding thread.
+ * The frames of a raw yuv output are appended by a single thread, in their order.
+ *
+ * @brief StreamProcessor::writeFrame
+ * @param index
+ * @param image
+ */
+void StreamProcessor::writeFrame(int index, const QImage& image) {
+    bool written;
+    if(yuvOutput.isOpen()) {
+        QByteArray frame = imageToYuv(image.convertToFormat(QImage::Format_RGBA8888));
+        written = yuvOutput.write(frame) == frame.size();
+    } else {
+
+        // a sequence keeps the names of its files, the frames of a raw file are numbered
+        QString fileName = yuvFileName.isEmpty() ? QFileInfo(frameFileName(index)).fileName()
+                                                 : QString("frame_%1.png").arg(index, 6, 10, QChar('0'));
+        written = image.save(outputDirectory.filePath(fileName));
+    }
+
+    if(written) {
+        writtenCount.ref();
+    } else {
+        QTextStream(stderr) << "cannot write frame " << index << endl;
+        failedCount.ref();
+    }
+}
+
+/**
+ * Converts a frame of yuv 4:2:0 in planes, with the limited range of BT.601, to rgba.
+ *
+ * @brief StreamProcessor::yuvToImage
+ * @param frame the luma plane then the u and v planes
+ * @param size the size of the frame, even in both directions
+ * @return the image in QImage::Format_RGBA8888
+ */
+QImage StreamProcessor::yuvToImage(const QByteArray& frame, const QSize& size) {
+    int width = size.width();
+    int height = size.height();
+    const uchar* yPlane = (const uchar*)frame.constData();
+    const uchar* uPlane = yPlane + width * height;
+    const uchar* vPlane = uPlane + (width / 2) * (height / 2);
+
+    QImage image(width, height, QImage::Format_RGBA8888);
+    for(int y = 0; y < height; y++) {
+        uchar* line = image.scanLine(y);
+        for(int x = 0; x < width; x++) {
+            float luma = 1.164f * (yPlane[y * width + x] - 16);
+            float u = uPlane[(y / 2) * (width / 2) + x / 2] - 128.0f;
+            float v = vPlane[(y / 2) * (width / 2) + x / 2] - 128.0f;
+            line[4*x] = (uchar)qBound(0.0f, luma + 1.596f * v + 0.5f, 255.0f);
+            line[4*x + 1] = (uchar)qBound(0.0f, luma - 0.813f * v - 0.391f * u + 0.5f, 255.0f);
+            line[4*x + 2] = (uchar)qBound(0.0f, luma + 2.018f * u + 0.5f, 255.0f);
+            line[4*x + 3] = 255;
+        }
+    }
+    return image;
+}
+
+/**
+ * Converts an image to a frame of yuv 4:2:0 in planes, with the limited range of BT.601.
+ * The chroma of a block of 2x2 pixels is the average of theirs.
+ *
+ * @brief StreamProcessor::imageToYuv
+ * @param image an image of even size, in QImage::Format_RGBA8888
+ * @return the luma plane then the u and v planes
+ */
+QByteArray StreamProcessor::imageToYuv(const QImage& image) {
+    int width = image.width();
+    int height = image.height();
+    QByteArray frame(width * height * 3 / 2, 0);
+    uchar* yPlane = (uchar*)frame.data();
+    uchar* uPlane = yPlane + width * height;
+    uchar* vPlane = uPlane + (width / 2) * (height / 2);
+
+    for(int y = 0; y < height; y += 2) {
+        for(int x = 0; x < width; x += 2) {
+            float u = 0.0f;
+            float v = 0.0f;
+            for(int dy = 0; dy < 2; dy++) {
+                const uchar* pixel = image.constScanLine(y + dy) + 4 * x;
+                for(int dx = 0; dx < 2; dx++, pixel += 4) {
+                    yPlane[(y + dy) * width + x + dx] = (uchar)(16.5f + 0.257f * pixel[0] + 0.504f * pixel[1] + 0.098f * pixel[2]);
+                    u += -0.148f * pixel[0] - 0.291f * pixel[1] + 0.439f * pixel[2];
+                    v += 0.439f * pixel[0] - 0.368f * pixel[1] - 0.071f * pixel[2];
+                }
+            }
+            uPlane[(y / 2) * (width / 2) + x / 2] = (uchar)qBound(0.0f, 128.5f + u / 4.0f, 255.0f);
+            vPlane[(y / 2) * (width / 2) + x / 2] = (uchar)qBound(0.0f, 128.5f + v / 4.0f, 255.0f);
+        }
+    }
+    return frame;
+}
+
+/**
+ * Runs the streaming mode in an offscreen context.
+ * Every frame goes through the pipeline and is written out, the frame rate is reported regularly
+ * and at the end.
+ *
+ * @brief StreamProcessor::run
+ * @param arguments
+ * @return the exit code of the application
+ */
+int StreamProcessor::run(const QStringList& arguments) {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // declaring the options
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Streams an image sequence or a raw yuv file through the filter pipeline.\n"
+                                     "Without a display, run with -platform offscreen (or minimalegl).");
+    parser.addHelpOption();
+    QCommandLineOption streamOption("stream", "Runs the streaming mode.");
+    QCommandLineOption filterOption("filter", "Appends a stage to the pipeline, with the syntax of the batch mode.", "stage");
+    QCommandLineOption inOption("in", "A directory of frames, a numbered pattern such as frames/img_%05d.png, "
+                                "or a raw yuv 4:2:0 file with --size.", "path");
+    QCommandLineOption outOption("out", "The directory receiving the processed frames, "
+                                 "or a .yuv file when the input is a raw yuv file.", "path");
+    QCommandLineOption sizeOption("size", "The size of the frames of a raw yuv file, such as 1920x1080.", "size");
+    QCommandLineOption startOption("start", "The number of the first frame of a pattern, 0 by default.", "number", "0");
+    QCommandLineOption prefetchOption("prefetch", "The number of frames decoded ahead.", "count",
+                                      QString::number(DEFAULT_PREFETCH_COUNT));
+    parser.addOption(streamOption);
+    parser.addOption(filterOption);
+    parser.addOption(inOption);
+    parser.addOption(outOption);
+    parser.addOption(sizeOption);
+    parser.addOption(startOption);
+    parser.addOption(prefetchOption);
+    parser.process(arguments);
+
+    if(!parser.isSet(inOption) || !parser.isSet(outOption)) {
+        err << "both --in and --out are required" << endl;
+        return 1;
+    }
+
+    // building the pipeline in the order of the options
+    pipeline.clear();
+    for(const QString& description : parser.values(filterOption)) {
+        FilterStage stage;
+        QString error;
+        if(!BatchProcessor::parseFilter(description, stage, error)) {
+            err << error << endl;
+            return 1;
+        }
+        pipeline.append(stage);
+    }
+    prefetchCount = qMax(1, parser.value(prefetchOption).toInt());
+
+    // counting the frames of the input, without keeping them
+    QString input = parser.value(inOption);
+    if(parser.isSet(sizeOption)) {
+        QStringList dimensions = parser.value(sizeOption).toLower().split('x');
+        frameSize = dimensions.size() == 2 ? QSize(dimensions[0].toInt(), dimensions[1].toInt()) : QSize();
+        if(frameSize.width() <= 0 || frameSize.height() <= 0 || frameSize.width() % 2 != 0 || frameSize.height() % 2 != 0) {
+            err << "the size of the yuv frames must be even, such as 1920x1080" << endl;
+            return 1;
+        }
+        yuvFileName = input;
+        frameCount = QFileInfo(input).size() / ((qint64)frameSize.width() * frameSize.height() * 3 / 2);
+    } else if(QFileInfo(input).isDir()) {
+        inputFiles = ImageDecoder::listImages(input);
+        frameCount = inputFiles.size();
+    } else {
+        if(!QRegExp("[^%]*%0?\\d*d[^%]*").exactMatch(input)) {
+            err << "the pattern must contain a single number such as %05d: " << input << endl;
+            return 1;
+        }
+        inputPattern = input;
+        firstNumber = parser.value(startOption).toInt();
+        while(QFileInfo(frameFileName(frameCount)).exists()) {
+            frameCount++;
+        }
+    }
+    if(frameCount == 0) {
+        err << "no frame in " << input << endl;
+        return 1;
+    }
+
+    // preparing the output, the frames of a raw yuv file are written by a single thread to keep their order
+    QString output = parser.value(outOption);
+    if(!yuvFileName.isEmpty() && output.endsWith(".yuv", Qt::CaseInsensitive)) {
+        yuvOutput.setFileName(output);
+        if(!yuvOutput.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot write " << output << endl;
+            return 1;
+        }
+        encodePool.setMaxThreadCount(1);
+    } else {
+        outputDirectory = QDir(output);
+        if(!outputDirectory.mkpath(".")) {
+            err << "cannot create " << outputDirectory.path() << endl;
+            return 1;
+        }
+    }
+
+    // creating the offscreen context, the shaders need opengl 3.3
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(format);
+    if(!context.create() || !context.makeCurrent(&surface)) {
+        err << "cannot create an OpenGL 3.3 context" << endl;
+        return 1;
+    }
+    out << "OpenGL renderer: " << (const char*)context.functions()->glGetString(GL_RENDERER) << endl;
+
+    ImageProcessor processor;
+    processor.initialize();
+    int maxTextureSize = processor.getMaxTextureSize();
+
+    // streaming: a frame is rendered while the previous one is read back,
+    // the next ones are decoded and the previous ones encoded meanwhile
+    QList<int> pendingIndexes;
+    QElapsedTimer timer;
+    QElapsedTimer reportTimer;
+    timer.start();
+    reportTimer.start();
+    int reportedCount = 0;
+    for(int index = 0; index < frameCount; index++) {
+        prefetch(index);
+        QString error;
+        QImage frame = takeFrame(index, error);
+        if(frame.isNull()) {
+            err << "cannot read frame " << index << ": " << error << endl;
+            failedCount.ref();
+            continue;
+        }
+
+        // a frame bigger than the biggest texture is processed in tiles once the pending renders are done,
+        // like in the batch mode
+        if(frame.width() > maxTextureSize || frame.height() > maxTextureSize) {
+            while(processor.getPendingRenderCount() > 0) {
+                encode(pendingIndexes.takeFirst(), processor.takeRenderedImage());
+            }
+            encode(index, processor.processTiled(frame, pipeline, ImageProcessor::DEFAULT_TILE_SIZE));
+        } else {
+            processor.loadImage(frame);
+            processor.startRender(pipeline);
+            pendingIndexes.append(index);
+            if(processor.getPendingRenderCount() > 1) {
+                encode(pendingIndexes.takeFirst(), processor.takeRenderedImage());
+            }
+        }
+
+        // the frame rate since the last report
+        if(reportTimer.elapsed() >= REPORT_INTERVAL) {
+            out << QString("frame %1/%2: %3 fps").arg(index + 1).arg(frameCount)
+                   .arg((index + 1 - reportedCount) * 1000.0 / reportTimer.elapsed(), 0, 'f', 1) << endl;
+            reportedCount = index + 1;
+            reportTimer.restart();
+        }
+    }
+
+    // the last renders and encodings
+    while(processor.getPendingRenderCount() > 0) {
+        encode(pendingIndexes.takeFirst(), processor.takeRenderedImage());
+    }
+    encodePool.waitForDone();
+    double seconds = timer.elapsed() / 1000.0;
+
+    // reporting the sustained frame rate
+    int writtenFrames = writtenCount.load();
+    out << QString("%1 frames streamed in %2 s (%3 fps)")
+           .arg(writtenFrames)
+           .arg(seconds, 0, 'f', 3)
+           .arg(seconds > 0.0 ? writtenFrames / seconds : 0.0, 0, 'f', 2) << endl;
+    return failedCount.load() == 0 ? 0 : 1;
+}
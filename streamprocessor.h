@@ -0,0 +1,85 @@
+#ifndef STREAMPROCESSOR_H
+#define STREAMPROCESSOR_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include "filterstage.h"
+
+/**
+ * The streaming mode of the command line.
+ * Pushes the frames of an image sequence or of a raw yuv file through the filter pipeline,
+ * with the decoding, the upload, the render, the readback and the encoding of successive frames overlapping:
+ * the next frames are decoded by a pool of threads, the gpu renders a frame while the previous one is read back,
+ * and the results are encoded by another pool. Every stage holds a bounded number of frames,
+ * so the memory used does not depend on the length of the sequence.
+ */
+class StreamProcessor
+{
+private:
+    class DecodeTask;
+    class EncodeTask;
+
+    QList<FilterStage> pipeline;
+
+    // the input: the files of a directory, a numbered file pattern such as frame_%04d.png, or a raw yuv file
+    QStringList inputFiles;
+    QString inputPattern;
+    int firstNumber;
+    QString yuvFileName;
+    QSize frameSize;
+    int frameCount;
+    QString frameFileName(int index) const;
+    QImage readFrame(int index, QString& error) const;
+
+    // the frames decoded ahead, by index, at most prefetchCount of them
+    QThreadPool decodePool;
+    QMutex mutex;
+    QWaitCondition decodedCondition;
+    QHash<int, QImage> decodedFrames;
+    QHash<int, QString> decodeErrors;
+    int prefetchCount;
+    int nextDecodedIndex;
+    void prefetch(int index);
+    void finishDecode(int index, const QImage& image, const QString& error);
+    QImage takeFrame(int index, QString& error);
+
+    // the output: a directory of images, or a raw yuv file written in the order of the frames
+    QDir outputDirectory;
+    QFile yuvOutput;
+    QThreadPool encodePool;
+    QSemaphore encodeSlots;
+    QAtomicInt writtenCount;
+    QAtomicInt failedCount;
+    void encode(int index, const QImage& image);
+    void writeFrame(int index, const QImage& image);
+
+public:
+    // the number of frames decoded ahead by default, and of frames waiting to be encoded
+    static const int DEFAULT_PREFETCH_COUNT = 8;
+    static const int ENCODE_QUEUE_SIZE = 4;
+
+    // the interval between two reports of the frame rate, in milliseconds
+    static const int REPORT_INTERVAL = 1000;
+
+    StreamProcessor();
+    ~StreamProcessor();
+    static bool isRequested(int argc, char *argv[]);
+    static QImage yuvToImage(const QByteArray& frame, const QSize& size);
+    static QByteArray imageToYuv(const QImage& image);
+
+    int run(const QStringList& arguments);
+};
+
+#endif // STREAMPROCESSOR_H